@@ -13,10 +13,35 @@ Each function owns its LocalST, and shares both the GlobalST and LocalST with it
 */
 
 #include "AST.h"
-#include "malloc.h"
+#include "Runtime.h"
+#include "Bounds.h"
+#include "Frame.h"
+#include "Inline.h"
+#include "Strength.h"
+#include "Tail.h"
+#include "Licm.h"
+#include "Peephole.h"
+#include "RegAlloc.h"
+#include "Sccp.h"
 #include <iostream>
-
-static FILE* FDOUT;   // file descriptor of a.s output file
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <cstdarg>
+
+static Emitter* EMIT;       // buffered writer for the a.s output file
+static InstrList* CODE;     // instructions of the function currently being generated
+static std::vector<InstrList*> FUNCTIONS;   // generated functions waiting for inlining, main last
+static bool REG_ARGS;       // pass the first arguments in $a0-$a3 instead of on the stack
+static bool DEBUG_HEAP;     // link the free that checks for memory errors
+static bool REGIONS;        // arrays that calls do not keep come from the region of their activation
+static Operand REGION_SAVE; // the word of the frame that holds the top of the region when the function started
+static const int REGION_BYTES = 1 << 20;    // memory taken from sbrk for the regions at the start
+static std::vector<Operand> TEMP_SLOTS; // frame words of the expression stack of the current function
+static int TEMP_DEPTH;      // words on the expression stack
+static const int MAX_STACK_WORDS = 4096;    // arrays only go into frames that stay within the 16 bit offsets of $fp
+static std::map<std::vector<int>, int> LITERALS;    // words of the constant literals in .data -> their number
+static const int MAX_STORED_LITERAL = 32;   // longer constant literals are copied from .data in a loop
 
 int ERROR_COUNT;
 void error(ErrorData err, std::string msg)
@@ -28,87 +53,206 @@ void error(ErrorData err, std::string msg)
     std::cout << "^\n";
 }
 
-void write(const char* msg, ...) {
-    va_list args;
-    va_start(args, msg);
-    vfprintf(FDOUT, msg, args);
-    va_end(args);
-    fprintf(FDOUT, "\n");
+// append an instruction to the current function. Comments are not kept in compact mode.
+void emit(Op op, Operand a, Operand b, Operand c, const std::string& comment = "") {
+    CODE->append(Instruction(op, a, b, c, EMIT->IsCompact() ? "" : comment));
+}
+
+void emit(Op op, Operand a, Operand b, const std::string& comment = "") {
+    emit(op, a, b, Operand(), comment);
+}
+
+void emit(Op op, Operand a, const std::string& comment = "") {
+    emit(op, a, Operand(), Operand(), comment);
+}
+
+void emit(Op op, const char* comment = "") {
+    emit(op, Operand(), Operand(), Operand(), comment);
+}
+
+void comment(const std::string& text) {
+    if(!EMIT->IsCompact()) CODE->append(Instruction(Op::COMMENT, Operand(), Operand(), Operand(), text));
+}
+
+void label(Operand l, const std::string& comment = "") {
+    emit(Op::LABEL, l, comment);
 }
 
 void stalloc() {
-    write("\taddi $sp, $sp, -4\t# allocate space on the stack. ");
+    emit(Op::ADDI, SP, SP, Imm(-4), "allocate space on the stack");
+}
+
+// The expression stack is a fixed word of the frame for every level of nesting,
+// so the frame holds the deepest expression of the function and $sp never moves.
+void push(Register reg) {
+    if(TEMP_DEPTH == (int)TEMP_SLOTS.size()) TEMP_SLOTS.push_back(CODE->NewSlot());
+    emit(Op::SW, reg, TEMP_SLOTS[TEMP_DEPTH++], "push onto the stack");
+}
+
+void pop(Register reg) {
+    emit(Op::LW, reg, TEMP_SLOTS[--TEMP_DEPTH], "pop the stack");
 }
 
-void push(const char* reg) {
+// the arguments of a call go on the real stack, where the callee finds them above its $fp
+void push_arg(Register reg) {
     stalloc();
-    write("\tsw %s, 4($sp)   \t# load %s onto the stack.", reg, reg);
+    emit(Op::SW, reg, Mem(4, SP), "push the argument onto the stack");
+}
+
+// take the words of an array from the region of the activation, returns its address in $v0
+static void region_alloc(int bytes) {
+    if(REGION_SAVE.kind == Operand::NONE) {
+        // the first array of the function remembers where its region starts
+        REGION_SAVE = CODE->NewSlot();
+        emit(Op::LA, T1, Lbl("rtop"));
+        emit(Op::LW, T0, Mem(0, T1), "the top of the region of the caller");
+        emit(Op::SW, T0, REGION_SAVE, "is where the region of this call starts");
+    }
+    emit(Op::LA, T1, Lbl("rtop"));
+    emit(Op::LW, V0, Mem(0, T1), "the array starts at the top of the region");
+    emit(Op::LI, T0, Imm(bytes));
+    emit(Op::ADDU, T0, V0, T0, "and the top moves past it");
+    emit(Op::LW, T2, Mem(4, T1), "the end of the regions");
+    emit(Op::BGT, T0, T2, Lbl("__error_nospace"), "no room left in the regions");
+    emit(Op::SW, T0, Mem(0, T1));
+}
+
+// drop the arrays of the function from the region with a single store
+static void reset_region() {
+    if(REGION_SAVE.kind == Operand::NONE) return;
+    emit(Op::LW, T0, REGION_SAVE, "where the region of this call started");
+    emit(Op::LA, T1, Lbl("rtop"));
+    emit(Op::SW, T0, Mem(0, T1), "free all of the arrays of the region");
+}
+
+// the label of a constant literal in .data, which holds its length followed by its elements
+static Operand literal_data(const std::vector<int>& words) {
+    auto found = LITERALS.find(words);
+    if(found == LITERALS.end()) found = LITERALS.insert({words, (int)LITERALS.size()}).first;
+    return Lbl("_literal", found->second);
+}
+
+// write the length and the elements of a constant literal into the array dest points to
+static void copy_literal(const std::vector<int>& values, Register dest, LabelTracker& LT) {
+    int n = values.size();
+    if(n <= MAX_STORED_LITERAL) {
+        emit(Op::LI, T1, Imm(n), "size of array");
+        emit(Op::SW, T1, Mem(0, dest), "put the number of elements in the start of the array");
+        for(int i = 0; i < n; i++) {
+            emit(Op::LI, T1, Imm(values[i]), "load the value of the element");
+            emit(Op::SW, T1, Mem(4*(i+1), dest), "place the value into the array");
+        }
+        return;
+    }
+    std::vector<int> words = {n};
+    words.insert(words.end(), values.begin(), values.end());
+    emit(Op::LA, T1, literal_data(words), "get the literal from the data section");
+    emit(Op::ADDIU, T2, T1, Imm(4*(n+1)), "end of the literal");
+    emit(Op::MOVE, T3, dest, "start of the array");
+    int loop = LT.counter;
+    LT.Label("_copyliteral");
+    emit(Op::LW, T4, Mem(0, T1), "load a word of the literal");
+    emit(Op::ADDIU, T1, T1, Imm(4), "next word of the literal");
+    emit(Op::SW, T4, Mem(0, T3), "store it into the array");
+    emit(Op::ADDIU, T3, T3, Imm(4), "next word of the array");
+    emit(Op::BNE, T1, T2, Lbl("_copyliteral", loop), "until the whole literal is copied");
 }
 
-void pop(const char* reg) {
-    write("\tlw %s, 4($sp)   \t# pop stack into %s", reg, reg);
-    write("\taddi $sp, $sp, 4 \t# restore the stack");
+static const Register temps[NUM_TEMPS] = {T0, T1, T2, T3, T4, T5, T6, T7, T8, T9};
+
+Register Temp(int reg) {
+    return temps[reg];
 }
 
 LabelTracker::LabelTracker()
 : if_count(0), if_stack(std::stack<int>()), while_count(0), while_stack(std::stack<int>()), counter(0) {}
 
 void LabelTracker::Label(const char* l)  {
-    write("%s%d:", l, counter);
+    label(Lbl(l, counter));
     counter++;
 }
 
-void LabelTracker::BranchElse(const char* reg) {
-    write("\tbeqz %s, _else%d\t\t# go to else branch", reg, if_count);
+void LabelTracker::BranchElse(ASTNode* condition) {
+    condition->EmitBranch(*this, false, Lbl("_else", if_count));
     if_stack.push(if_count);
     if_count++;
 }
 
 void LabelTracker::JumpEndIf() {
-    write("\tj _endif%d\t\t# go to if statement", if_stack.top());
+    emit(Op::J, Lbl("_endif", if_stack.top()), "go to end of if statement");
 }
 
 void LabelTracker::ElseLabel() {
-    write("_else%d:\t\t# else branch", if_stack.top());
+    label(Lbl("_else", if_stack.top()), "else branch");
 }
 
 void LabelTracker::EndIfLabel() {
-    write("_endif%d:\t\t# end of if statement", if_stack.top());
+    label(Lbl("_endif", if_stack.top()), "end of if statement");
     if_stack.pop();
 }
 
 void LabelTracker::BeginWhileLabel() {
-    write("_beginwhile%d:\t\t# begin of while loop", while_count);
+    label(Lbl("_beginwhile", while_count), "begin of while loop");
     while_stack.push(while_count);
     while_count++;
 }
 
-void LabelTracker::BranchWhile(const char* reg) {
-    write("\tbeqz %s, _endwhile%d\t# go to end of while", reg, while_stack.top());
+void LabelTracker::BranchWhile(ASTNode* condition) {
+    condition->EmitBranch(*this, false, Lbl("_endwhile", while_stack.top()));
 }
 
 void LabelTracker::JumpBeginWhile() {
-    write("\tj _beginwhile%d\t\t# jump to begin of while", while_stack.top());
+    emit(Op::J, Lbl("_beginwhile", while_stack.top()), "jump to begin of while");
 }
 
 void LabelTracker::EndWhileLabel() {
-    write("_endwhile%d:\t\t# end of while loop", while_stack.top());
+    label(Lbl("_endwhile", while_stack.top()), "end of while loop");
     while_stack.pop();
 }
 
 
 ASTNode::ASTNode(ErrorData err) :err_data(err) {}
 
-ProgramNode::ProgramNode(ASTNode* func_list, ASTNode* main, FILE* fdout) 
+// expressions without their own register code leave their value on the stack
+void ASTNode::EmitValue(LabelTracker& LT, int reg) {
+    EmitCode(LT);
+    pop(Temp(reg));
+}
+
+void ASTNode::EmitBranch(LabelTracker& LT, bool when, Operand target) {
+    EmitValue(LT, 0);
+    emit(when ? Op::BNEZ : Op::BEQZ, T0, target, when ? "branch if true" : "branch if false");
+}
+
+// fold an expression and delete it if it was replaced
+static ASTNode* FoldNode(ASTNode* node) {
+    ASTNode* folded = node->Fold();
+    if(folded != node) delete node;
+    return folded;
+}
+
+// take a child out of its parent so it can replace the parent
+static ASTNode* Release(ASTNode*& child) {
+    ASTNode* node = child;
+    child = nullptr;
+    return node;
+}
+
+ProgramNode::ProgramNode(ASTNode* func_list, ASTNode* main, Emitter* emitter, bool reg_args, bool debug_heap, bool regions) 
 : ASTNode(ErrorData(nullptr, 0, 0))
 {
-    FDOUT = fdout;
+    EMIT = emitter;
+    REG_ARGS = reg_args;
+    DEBUG_HEAP = debug_heap;
+    REGIONS = regions;
     func_def_list = static_cast<FuncDefListNode*>(func_list);
     main_def = static_cast<MainDefNode*>(main);
     setGlobalST(new SymbolTable());
     bool func_list_checked = func_def_list->TypeCheck();
     bool main_checked = main_def->TypeCheck();
     if(func_list_checked && main_checked) {
+        func_def_list->Fold();
+        main_def->Fold();
         LabelTracker LT = LabelTracker();
         EmitCode(LT);
     }
@@ -132,48 +276,99 @@ void ProgramNode::setLocalST(SymbolTable* ST) {
 }
 
 void ProgramNode::EmitCode(LabelTracker& LT) {
-    write("\t.data");
-    write("\ttrue: .asciiz \"true\"\t# define the true string");
-    write("\tfalse: .asciiz \"false\"\t# define the false string");
-    write("\tdiv0: .asciiz \"runtime error: cannot divide by zero.\"");
-    write("\tnospace: .asciiz \"runtime error: malloc cannot allocate requested number of bytes\"");
-    write("\toutofbounds: .asciiz \"runtime error: index out of bounds.\"");
-    fprintf(FDOUT, "%s", MALLOC_HEADER);
-    write("\t.align 2");
-    write("\t.text");
-    write("\n\t### BEGIN ###");
-    write("\tmove $fp, $sp\t\t# move the frame pointer to the top of the stack");
-    write("\tjal __main\t# jump to the main function");
-    write("\n\t### END ###");
-    write("__exit:");
-    write("\tli $v0, 10\t#load value for exit");
-    write("\tsyscall   \t#exit the program");
-
-    // *** runtime exception code ***
-    write("\n\t### runtime errors ###");
-    write("__error_div0:\t\t# runtime error for division by zero");
-    write("\tla $a0, div0\t\t# load the runtime error string");
-    write("\tli $v0, 4    \t\t# load the print string service");
-    write("\tsyscall");
-    write("\tj __exit       \t\t# exit the program");
-
-    write("\n__error_outofbounds:\t\t# runtime error for out of bounds array access");
-    write("\tla $a0, outofbounds\t\t# load the error string");
-    write("\tli $v0, 4    \t\t# load the print string service");
-    write("\tsyscall");
-    write("\tj __exit       \t\t# exit the program");
-
-    write("\n__error_nospace:\t\t# runtime error for malloc allocating wrong amount of space");
-    write("\tla $a0, nospace\t\t# load the error string");
-    write("\tli $v0, 4    \t\t# load the print string service");
-    write("\tsyscall");
-    write("\tj __exit       \t\t# exit the program");
-
     func_def_list->EmitCode(LT);
     main_def->EmitCode(LT);
+    InlineCalls(FUNCTIONS);
+    EliminateTailCalls(FUNCTIONS);
+    // the runtime the optimized functions still refer to
+    Runtime runtime(DEBUG_HEAP);
+    for(InstrList* list : FUNCTIONS) {
+        finish_func(list);
+        runtime.Scan(*list);
+    }
+
+    InstrList startup("startup");
+    CODE = &startup;
+    comment("### BEGIN ###");
+    emit(Op::MOVE, FP, SP, "move the frame pointer to the top of the stack");
+    if(runtime.Uses("rtop")) {
+        emit(Op::LI, A0, Imm(REGION_BYTES), "the memory of the regions");
+        emit(Op::LI, V0, Imm(9), "load the sbrk service");
+        emit(Op::SYSCALL);
+        emit(Op::LA, T0, Lbl("rtop"));
+        emit(Op::SW, V0, Mem(0, T0), "the regions start empty");
+        emit(Op::ADDU, V0, V0, A0);
+        emit(Op::SW, V0, Mem(4, T0), "and end after it");
+    }
+    emit(Op::JAL, Lbl("__main"), "jump to the main function");
+    comment("### END ###");
+    label(Lbl("__exit"));
+    bool output = runtime.Uses("__flush");
+    if(output) emit(Op::JAL, Lbl("__flush"), "print what is left in the output buffer");
+    if(output) runtime.Use("__trap");   // traps such as an overflow print the buffer as well
+    emit(Op::LI, V0, Imm(10), "load value for exit");
+    emit(Op::SYSCALL, "exit the program");
 
-    fprintf(FDOUT, "%s", MALLOC_BODY);
+    // *** runtime exception code ***
+    // only the handlers the functions branch to
+    if(runtime.Uses("__error_div0")) {
+        comment("### runtime errors ###");
+        label(Lbl("__error_div0"), "runtime error for division by zero");
+        if(output) emit(Op::JAL, Lbl("__flush"), "the output so far comes before the error");
+        emit(Op::LA, A0, Lbl("div0"), "load the runtime error string");
+        emit(Op::LI, V0, Imm(4), "load the print string service");
+        emit(Op::SYSCALL);
+        emit(Op::J, Lbl("__exit"), "exit the program");
+    }
+
+    if(runtime.Uses("__error_outofbounds")) {
+        label(Lbl("__error_outofbounds"), "runtime error for out of bounds array access");
+        if(output) emit(Op::JAL, Lbl("__flush"), "the output so far comes before the error");
+        emit(Op::LA, A0, Lbl("outofbounds"), "load the error string");
+        emit(Op::LI, V0, Imm(4), "load the print string service");
+        emit(Op::SYSCALL);
+        emit(Op::J, Lbl("__exit"), "exit the program");
+    }
+
+    if(runtime.Uses("__error_nospace")) {
+        label(Lbl("__error_nospace"), "runtime error for malloc allocating wrong amount of space");
+        if(output) emit(Op::JAL, Lbl("__flush"), "the output so far comes before the error");
+        emit(Op::LA, A0, Lbl("nospace"), "load the error string");
+        emit(Op::LI, V0, Imm(4), "load the print string service");
+        emit(Op::SYSCALL);
+        emit(Op::J, Lbl("__exit"), "exit the program");
+    }
+    runtime.Scan(startup);
+    EMIT->line("\t.text");
+    EMIT->emit(startup);
+
+    for(InstrList* list : FUNCTIONS) {
+        EMIT->emit(*list);
+        delete list;
+        EMIT->MaybeFlush();
+    }
+    FUNCTIONS.clear();
+
+    // the constant literals the functions copy their arrays from
+    if(!LITERALS.empty()) {
+        std::vector<const std::vector<int>*> literals(LITERALS.size());
+        for(const auto& [words, n] : LITERALS) literals[n] = &words;
+        EMIT->line("\t.data");
+        for(size_t n = 0; n < literals.size(); n++) {
+            const std::vector<int>& words = *literals[n];
+            for(size_t i = 0; i < words.size(); i += 16) {
+                std::string text = i == 0 ? LabelName(Lbl("_literal", n).value) + ":" : "";
+                text += "\t.word ";
+                for(size_t j = i; j < std::min(words.size(), i + 16); j++) {
+                    text += (j == i ? "" : ", ") + std::to_string(words[j]);
+                }
+                EMIT->line(text.c_str());
+            }
+        }
+    }
 
+    runtime.Emit(EMIT);
+    EMIT->flush();
 }
 
 MainDefNode::MainDefNode(ASTNode* decl_list, ASTNode* stmts, ErrorData err) 
@@ -217,39 +412,61 @@ bool MainDefNode::TypeCheck() {
 
 }
 
+ASTNode* MainDefNode::Fold() {
+    stmt_list->Fold();
+    return this;
+}
+
 void MainDefNode::EmitCode(LabelTracker& LT) {
-    begin_func("main");
+    begin_func("main", LocalST->size());
+    CODE->start = CODE->code.size();
     local_decl_list->EmitCode(LT);
     stmt_list->EmitCode(LT);
     // free any arrays allocated by the function
     for(SymbolInfo* arr : LocalST->FindLocalArrays()) {
         int offset = arr->GetOffset();
-        write("\tlw $t0, %d($fp)\t\t# load address of array for freeing", offset);
-        write("\tmove $a0, $t0\t\t# pass address of array to free()");
-        write("\tjal free\t\t\t# free the array");
+        emit(Op::LW, T0, Mem(offset, FP), "load address of array for freeing");
+        emit(Op::MOVE, A0, T0, "pass address of array to free()");
+        emit(Op::JAL, Lbl("free"), "free the array");
     }
-    end_func("main");
+    reset_region();
+    end_func();
 }
 
 
-void begin_func(std::string name) {
-    write("\n\t###########################");
-    write("\t### \t %s \t ###", name.c_str());
-    write("\t###########################");
-    write("__%s:", name.c_str());
-    write("\taddi $sp, $sp, -8\t\t# make space for $fp and $ra on stack");
-    write("\tsw $ra, 4($sp)\t\t# store the return address");
-    write("\tsw $fp, 8($sp)\t\t# store the old frame pointer");
-    write("\tmove $fp, $sp\t\t# move the frame pointer to the top of the stack");
+// start the instruction list of a new function. Every local variable has a word
+// in the frame, and the prologue that allocates it is added by finish_func.
+void begin_func(std::string name, int locals) {
+    CODE = new InstrList(name);
+    comment("###########################");
+    comment("### \t " + name + " \t ###");
+    comment("###########################");
+    label(Lbl("__" + name));
+    CODE->body = CODE->code.size();
+    CODE->frame_words = locals;
+    TEMP_SLOTS.clear();
+    TEMP_DEPTH = 0;
+    REGION_SAVE = Operand();
 }
 
-void end_func(std::string name) {
-    write("\t### END OF FUNCTION \"%s\" ###", name.c_str());
-    write("\tmove $sp, $fp\t\t# clear the stack of local variables");
-    write("\tlw $ra, 4($fp)\t\t# fetch the $ra from the stack");
-    write("\tlw $fp, 8($fp)\t\t# reset the $fp to the caller state");
-    write("\taddi $sp, $sp, 8\t# reset the stack");
-    write("\tjr $ra");
+// keep the generated function until all the others are generated, so calls to it can be inlined
+void end_func() {
+    FUNCTIONS.push_back(CODE);
+    CODE = nullptr;
+}
+
+// optimize the function and give it its prologue and epilogue. It is printed
+// once the runtime it uses is known, after the startup code.
+void finish_func(InstrList* list) {
+    CODE = list;
+    comment("### END OF FUNCTION \"" + list->name + "\" ###");
+    PropagateConstants(*CODE);
+    HoistInvariants(*CODE);
+    RemoveBoundsChecks(*CODE);
+    ReduceStrength(*CODE);
+    BuildFrame(*CODE, AllocateLocals(*CODE));
+    Peephole(*CODE);
+    CODE = nullptr;
 }
 
 
@@ -304,6 +521,7 @@ void FuncDefNode::setLocalST(SymbolTable* ST) {
 bool FuncDefNode::TypeCheck() {
     std::string lexeme = identifier->getLexeme();
     bool params_check = params_list->TypeCheck();   // put parameters in local ST
+    static_cast<FunctionInfo*>(GlobalST->lookup(lexeme))->SetParams(params_list->getInfos());
     bool decl_check = local_decl_list->TypeCheck();
     bool stmt_check = stmt_list->TypeCheck();
     bool return_check = CheckReturn();
@@ -339,29 +557,49 @@ bool FuncDefNode::CheckReturn() {
     return true;
 }
 
+ASTNode* FuncDefNode::Fold() {
+    stmt_list->Fold();
+    return this;
+}
+
 void FuncDefNode::EmitCode(LabelTracker& LT) {
     std::string lexeme = identifier->getLexeme();
-    begin_func(lexeme);
+    begin_func(lexeme, LocalST->size());
     params_list->EmitCode(LT);
     // TODO: initialize values of parameters from the stack
     // based on the size of params_list
     int n = params_list->getSize();
-    for( int i=0; i < n; i++ ) {
-        // stack offset from frame pointer is number of parameters plus 2 for $fp and $ra 
-        int fp_offset = n + 2;    
-        write("\tlw $t0, %d($fp)\t\t# load the value of the argument", 4 * (fp_offset - i));
-        write("\tsw $t0, %d($fp)\t\t# write the value to the local variable", -4 * i);
+    if(REG_ARGS) {
+        CODE->reg_args = true;
+        for(int i = 0; i < std::min(n, NUM_ARG_REGS); i++) {
+            emit(Op::SW, (Register)(A0 + i), Mem(-4 * i, FP), "write the argument in $a" + std::to_string(i) + " to the local variable");
+        }
+        params_list->ReadInPlace(NUM_ARG_REGS);
+    }
+    else {
+        for( int i=0; i < n; i++ ) {
+            // stack offset from frame pointer is number of parameters plus 2 for $fp and $ra 
+            int fp_offset = n + 2;    
+            emit(Op::LW, T0, Mem(4 * (fp_offset - i), FP), "load the value of the argument");
+            emit(Op::SW, T0, Mem(-4 * i, FP), "write the value to the local variable");
+        }
     }
+    CODE->params = n;
+    CODE->start = CODE->code.size();
     local_decl_list->EmitCode(LT);
     stmt_list->EmitCode(LT);
-    // free any arrays allocated by the function
-    for(SymbolInfo* arr : LocalST->FindLocalArrays()) {
+    // free any arrays allocated by the function, keeping the return value across the calls
+    std::vector<SymbolInfo*> arrays = LocalST->FindLocalArrays();
+    if(!arrays.empty()) push(V0);
+    for(SymbolInfo* arr : arrays) {
         int offset = arr->GetOffset();
-        write("\tlw $t0, %d($fp)\t\t# load address of array for freeing", offset);
-        write("\tmove $a0, $t0\t\t\t# pass address of array to free()");
-        write("\t jal free\t\t\t# free the array");
+        emit(Op::LW, T0, Mem(offset, FP), "load address of array for freeing");
+        emit(Op::MOVE, A0, T0, "pass address of array to free()");
+        emit(Op::JAL, Lbl("free"), "free the array");
     }
-    end_func(lexeme);
+    if(!arrays.empty()) pop(V0);
+    reset_region();
+    end_func();
 }
 
 ReturnNode::ReturnNode(ASTNode* expr, ErrorData err)
@@ -371,7 +609,7 @@ ReturnNode::ReturnNode(ASTNode* expr, ErrorData err)
 }
 
 ReturnNode::ReturnNode(ErrorData err)
-: ASTNode(err) {}
+: ASTNode(err), expression(nullptr) {}
 
 ReturnNode::~ReturnNode() {
     delete expression;
@@ -389,6 +627,9 @@ void ReturnNode::setLocalST(SymbolTable* ST) {
 
 bool ReturnNode::TypeCheck() {
     if(expression) {
+        // the expression records the arrays its calls are passed
+        if(!expression->TypeCheck()) return false;
+        expression->Escape();
         setType(expression->getType());
     }
     else {
@@ -401,9 +642,14 @@ std::vector<ASTNode*> ReturnNode::FindReturns() {
     return {this};
 }
 
+ASTNode* ReturnNode::Fold() {
+    if(expression) expression = FoldNode(expression);
+    return this;
+}
+
 void ReturnNode::EmitCode(LabelTracker& LT) {
-    expression->EmitCode(LT);   // evaluate the expression
-    pop("$v0");                 // put the return value in $v0
+    expression->EmitValue(LT, 0);   // evaluate the expression
+    emit(Op::MOVE, V0, T0, "put the return value in $v0");
 }
 
 ParamsListNode::ParamsListNode(ASTNode* param, ErrorData err)
@@ -437,6 +683,7 @@ std::vector<TypeInfo> ParamsListNode::getTypes() {
 }
 
 void ParamsListNode::setLocalST(SymbolTable* ST) {
+    LocalST = ST;
     for(VarDeclNode* param : *parameters) {
         param->setLocalST(ST);
     }
@@ -455,9 +702,23 @@ bool ParamsListNode::TypeCheck() {
     return checked;
 }
 
+std::vector<SymbolInfo*> ParamsListNode::getInfos() {
+    std::vector<SymbolInfo*> infos;
+    for(VarDeclNode* param : *parameters) infos.push_back(LocalST->lookup(param->getLexeme()));
+    return infos;
+}
+
 void ParamsListNode::EmitCode(LabelTracker& LT) {
     for(VarDeclNode* param : *parameters) {
-        param->EmitCode(LT);  // allocate space for the parameters
+        param->EmitCode(LT);  // initialize the slots of the parameters
+    }
+}
+
+// point the parameters at the words the caller pushed, which are above $fp and $ra
+void ParamsListNode::ReadInPlace(int first) {
+    int n = parameters->size();
+    for(int i = first; i < n; i++) {
+        (*parameters)[i]->SetOffset(4 * (n + 2 - i));
     }
 }
 
@@ -494,6 +755,13 @@ void FuncDefListNode::setGlobalST(SymbolTable* ST) {
     }
 }
 
+ASTNode* FuncDefListNode::Fold() {
+    for(FuncDefNode* func_def : *func_def_list) {
+        func_def->Fold();
+    }
+    return this;
+}
+
 void FuncDefListNode::EmitCode(LabelTracker& LT) {
     for(FuncDefNode* func_def : *func_def_list) {
         func_def->EmitCode(LT);
@@ -593,9 +861,14 @@ void VarDeclNode::setLocalST(SymbolTable* ST) {
     identifier->setLocalST(ST);
 }
 
+void VarDeclNode::SetOffset(int offset) {
+    LocalST->lookup(identifier->getLexeme())->SetOffset(offset);
+}
+
 void VarDeclNode::EmitCode(LabelTracker& LT) {
-    write("\taddi $sp, $sp, -4\t# allocating space for '%s'", identifier->getLexeme().c_str());
-    write("\tlw $zero, 4($sp)\t# initializing '%s' to default of 0", identifier->getLexeme().c_str());
+    std::string lexeme = identifier->getLexeme();
+    int offset = LocalST->lookup(lexeme)->GetOffset();
+    emit(Op::SW, ZERO, Mem(offset, FP), "initializing '" + lexeme + "' to default of 0");
 }
 
 ArrayDeclNode::ArrayDeclNode(ASTNode* id, ASTNode* tp, ASTNode* len, ErrorData err)
@@ -649,18 +922,37 @@ void ArrayDeclNode::EmitCode(LabelTracker& LT) {
     // four bytes for the size of the array 
     // The pointer to the array is returned in $v0
     // The number of bytes allocated is returned in $v1
-    write("\taddi $sp, $sp, -4\t# allocate space on the stack for '%s'", identifier->getLexeme().c_str());
-    write("\tli $t0, 0x0\t\t\t# load nullptr for array initialization");
-    write("\tlw $t0, 4($sp)\t\t# initialize array ptr to 0x0");
+    SymbolInfo* info = LocalST->lookup(identifier->getLexeme());
+    int offset = info->GetOffset();
+    CODE->array_lengths[offset] = getType().size;
+    if(!info->Escapes() && CODE->frame_words + getType().size + 1 <= MAX_STACK_WORDS) {
+        // the array is only indexed in this function, so it can live in the frame
+        info->KeepOnStack();
+        Operand array = CODE->NewArray(getType().size);
+        emit(Op::ADDIU, T0, FP, Imm(array.value), "point to the array in the frame");
+        emit(Op::LI, T1, Imm(getType().size), "number of elements in array");
+        emit(Op::SW, T1, Mem(0, T0), "put the number of elements in the start of the array");
+        emit(Op::SW, T0, Mem(offset, FP), "store a pointer to the array on the stack");
+        return;
+    }
     int size = 4*(getType().size + 1);
-    write("\tli, $a0, %d\t\t\t# request %d bytes from malloc", size, size);
-    write("\tjal malloc");
-    // TODO: add a runtime error for space not allocated.
-    write("\tli $t0, %d\t\t# load bytes that should be allocated", size + 20);
-    write("\tbne $a0, $t0, __error_nospace\t\t# compare requested bytes with allocated bytes");
-    write("\tsw $v0, 4($sp)\t\t# store a pointer to the array on the stack");
-    write("\tli $t0, %d\t\t\t# number of elements in array", getType().size);
-    write("\tsw $t0, ($v0)\t\t# put the number of elements in the start of the array");
+    if(REGIONS && !info->Kept()) {
+        // the calls it is passed to do not keep it, so it ends with this activation
+        info->KeepInRegion();
+        region_alloc(size);
+        emit(Op::SW, V0, Mem(offset, FP), "store a pointer to the array on the stack");
+        emit(Op::LI, T0, Imm(getType().size), "number of elements in array");
+        emit(Op::SW, T0, Mem(0, V0), "put the number of elements in the start of the array");
+        return;
+    }
+    emit(Op::SW, ZERO, Mem(offset, FP), "initialize array ptr to 0x0");
+    emit(Op::LI, A0, Imm(size), "request " + std::to_string(size) + " bytes from malloc");
+    emit(Op::JAL, Lbl("malloc"));
+    emit(Op::LI, T0, Imm(size), "load bytes that should be allocated");
+    emit(Op::BGT, T0, V1, Lbl("__error_nospace"), "compare requested bytes with allocated bytes");
+    emit(Op::SW, V0, Mem(offset, FP), "store a pointer to the array on the stack");
+    emit(Op::LI, T0, Imm(getType().size), "number of elements in array");
+    emit(Op::SW, T0, Mem(0, V0), "put the number of elements in the start of the array");
     // TODO: Should array elements be manually initialized to zero?
     // write("\tli $t0, 0\t\t\t# load zero for array element initialization");
     // for(int i=0; i<getType().size; i++) {
@@ -687,6 +979,16 @@ void ArrayLiteralNode::append(ASTNode* expression) {
     expressions->push_back(expression);
 } 
 
+void ArrayLiteralNode::setGlobalST(SymbolTable* ST) {
+    GlobalST = ST;
+    for(ASTNode* expr : *expressions) expr->setGlobalST(ST);
+}
+
+void ArrayLiteralNode::setLocalST(SymbolTable* ST) {
+    LocalST = ST;
+    for(ASTNode* expr : *expressions) expr->setLocalST(ST);
+}
+
 bool ArrayLiteralNode::TypeCheck() {
     bool check = true;
     for(ASTNode* expr : *expressions) {
@@ -723,6 +1025,23 @@ bool ArrayLiteralNode::TypeCheck() {
     return check;
 }
 
+ASTNode* ArrayLiteralNode::Fold() {
+    for(ASTNode*& expr : *expressions) {
+        expr = FoldNode(expr);
+    }
+    return this;
+}
+
+bool ArrayLiteralNode::GetValues(std::vector<int>& values) {
+    values.clear();
+    for(ASTNode* expr : *expressions) {
+        int value;
+        if(!expr->GetConstant(value)) return false;
+        values.push_back(value);
+    }
+    return true;
+}
+
 void ArrayLiteralNode::EmitCode(LabelTracker& LT) {
     // Array literals are used to set the values of arrays declared in memory
     // 1. Evaluate the expressions on the right and store their results on the stack
@@ -730,25 +1049,58 @@ void ArrayLiteralNode::EmitCode(LabelTracker& LT) {
     // 3. Set the first element to the size of the array
     // 4. Put the values of the expressions in the array
     // 5. Push the pointer to the start of the array onto the stack
-
-    write("\t### Array Literal ###");
+    // A literal of constants is copied into the array instead of evaluated
+
+    comment("### Array Literal ###");
+    std::vector<int> values;
+    if(GetValues(values)) {
+        int size = 4*(values.size() + 1);
+        emit(Op::LI, A0, Imm(size), "request " + std::to_string(size) + " bytes from malloc");
+        emit(Op::JAL, Lbl("malloc"));
+        copy_literal(values, V0, LT);
+        push(V0);
+        return;
+    }
     // iterate the expressions backwards so they come off the stack in order
     for(std::vector<ASTNode*>::reverse_iterator riter = expressions->rbegin(); 
         riter != expressions->rend(); ++riter) {
         (*riter)->EmitCode(LT);
     }
     int size = 4*(getType().size + 1);
-    write("\tli, $a0, %d\t\t# request %d bytes from malloc", size, size);
-    write("\tjal malloc");
-    write("\tli $t0, %d\t# size of array", getType().size);
-    write("\tsw $t0, ($v0)\t# put the number of elements in the start of the array");
+    emit(Op::LI, A0, Imm(size), "request " + std::to_string(size) + " bytes from malloc");
+    emit(Op::JAL, Lbl("malloc"));
+    emit(Op::LI, T0, Imm(getType().size), "size of array");
+    emit(Op::SW, T0, Mem(0, V0), "put the number of elements in the start of the array");
     // put the values into the array
     for(size_t i=0; i < expressions->size(); i++) {
-        pop("$t0");
+        pop(T0);
         // put the value into the array at index i+1
-        write("\tsw $t0, %d($v0)\t\t# place the value into the array", 4*(i+1));
+        emit(Op::SW, T0, Mem(4*(i+1), V0), "place the value into the array");
+    }
+    push(V0);
+}
+
+// the array already has the size of the literal, so its elements are written over
+void ArrayLiteralNode::EmitInPlace(LabelTracker& LT, int offset) {
+    comment("### Array Literal ###");
+    std::vector<int> values;
+    if(GetValues(values)) {
+        emit(Op::LW, T0, Mem(offset, FP), "get the array to fill");
+        copy_literal(values, T0, LT);
+        return;
+    }
+    // the elements may read the array, so they are all evaluated before it changes
+    for(std::vector<ASTNode*>::reverse_iterator riter = expressions->rbegin();
+        riter != expressions->rend(); ++riter) {
+        (*riter)->EmitCode(LT);
+    }
+    emit(Op::LW, V0, Mem(offset, FP), "get the array to fill");
+    emit(Op::LI, T0, Imm(getType().size), "size of array");
+    emit(Op::SW, T0, Mem(0, V0), "put the number of elements in the start of the array");
+    for(size_t i=0; i < expressions->size(); i++) {
+        pop(T0);
+        emit(Op::SW, T0, Mem(4*(i+1), V0), "place the value into the array");
     }
-    push("$v0");
 }
 
 
@@ -805,9 +1157,18 @@ std::vector<ASTNode*> StatementListNode::FindReturns() {
     return returns;
 }
 
+ASTNode* StatementListNode::Fold() {
+    for(ASTNode*& stmt : *stmt_list) {
+        if(stmt) stmt = FoldNode(stmt);
+    }
+    return this;
+}
+
 void StatementListNode::EmitCode(LabelTracker& LT) {
     for(ASTNode* stmt: *stmt_list) {
-        if(stmt) stmt->EmitCode(LT);
+        if(!stmt) continue;
+        stmt->EmitCode(LT);
+        TEMP_DEPTH = 0;     // nothing on the expression stack outlives its statement
     }
 }
 
@@ -838,9 +1199,35 @@ bool AssignmentStatementNode::TypeCheck() {
     else {
         identifier->Initialize();
     }
+    // assigning a whole array frees the old one and points to the new one, which is
+    // shared when another variable names it as well
+    if(!LiteralTarget()) {
+        if(dynamic_cast<IdentifierNode*>(expression)) identifier->Escape();
+        else identifier->Replace();
+    }
+    expression->Escape();
     return true;
 }
 
+// the local array a literal is assigned to, or nullptr
+SymbolInfo* AssignmentStatementNode::LiteralTarget() {
+    IdentifierNode* id = dynamic_cast<IdentifierNode*>(identifier);
+    if(!id || !dynamic_cast<ArrayLiteralNode*>(expression)) return nullptr;
+    SymbolInfo* info = LocalST->lookup(id->getLexeme());
+    return info && info->IsLocal() ? info : nullptr;
+}
+
+/*
+    A literal assigned to a local array is written over the elements the array already has,
+    unless the array may be shared: when it is assigned another variable, assigned to one,
+    returned or passed to a call that keeps it. That is only known once every function has
+    been checked, so it is decided when the code is generated.
+*/
+bool AssignmentStatementNode::InPlace() {
+    SymbolInfo* info = LiteralTarget();
+    return info && !info->Shared();
+}
+
 void AssignmentStatementNode::setGlobalST(SymbolTable* ST) {
     GlobalST = ST;
     identifier->setGlobalST(ST);
@@ -853,7 +1240,18 @@ void AssignmentStatementNode::setLocalST(SymbolTable* ST) {
     expression->setLocalST(ST);
 }
 
+ASTNode* AssignmentStatementNode::Fold() {
+    identifier->Fold();     // the index of an array element
+    expression = FoldNode(expression);
+    return this;
+}
+
 void AssignmentStatementNode::EmitCode(LabelTracker& LT) {
+    if(InPlace()) {
+        int offset = LocalST->lookup(identifier->getLexeme())->GetOffset();
+        static_cast<ArrayLiteralNode*>(expression)->EmitInPlace(LT, offset);
+        return;
+    }
     expression->EmitCode(LT); // expression does its thing and stores its result at 4($sp)
     identifier->EmitSetCode(LT);
 }
@@ -900,6 +1298,20 @@ void ActualArgsNode::setLocalST(SymbolTable* ST) {
     }
 }
 
+// check the expressions passed to a call, which also records the arrays that calls
+// inside them are passed. A variable may be passed before it is initialized, so
+// that the callee can fill it in.
+bool ActualArgsNode::CheckArgs() {
+    bool check = true;
+    for(ASTNode* arg : *actual_args) {
+        if(dynamic_cast<IdentifierNode*>(arg)) continue;
+        if(!arg->TypeCheck()) {
+            check = false;
+        }
+    }
+    return check;
+}
+
 std::vector<TypeInfo> ActualArgsNode::argTypes() {
     std::vector<TypeInfo> types = {};
     for(ASTNode* arg : *actual_args) {
@@ -908,14 +1320,63 @@ std::vector<TypeInfo> ActualArgsNode::argTypes() {
     return types;
 }
 
+ASTNode* ActualArgsNode::Fold() {
+    for(ASTNode*& arg : *actual_args) {
+        arg = FoldNode(arg);
+    }
+    return this;
+}
+
+void ActualArgsNode::Lend(FunctionInfo* func) {
+    for(size_t i = 0; i < actual_args->size(); i++) {
+        (*actual_args)[i]->Lend(func, i);
+    }
+}
+
 void ActualArgsNode::EmitCode(LabelTracker& LT) {
-    write("\t### Actual Args ###");
+    comment("### Actual Args ###");
     // The arguments will be pulled off the stack in reverse order,
     // so we must put them on in reverse order
     for(ASTNode* arg: *actual_args) {
-        arg->EmitCode(LT);
+        arg->EmitValue(LT, 0);
+        push_arg(T0);
+    }
+    comment("### End of Actual Args");
+}
+
+void ActualArgsNode::EmitRegisters(LabelTracker& LT) {
+    comment("### Actual Args ###");
+    int n = actual_args->size();
+    int in_regs = std::min(n, NUM_ARG_REGS);
+    bool calls = std::any_of(actual_args->begin(), actual_args->end(), [](ASTNode* arg) { return arg->HasCall(); });
+    if(!calls) {
+        for(int i = 0; i < n; i++) {
+            if(i < in_regs) {
+                (*actual_args)[i]->EmitValue(LT, 0);
+                emit(Op::MOVE, (Register)(A0 + i), T0, "pass the argument in $a" + std::to_string(i));
+            }
+            else {
+                (*actual_args)[i]->EmitValue(LT, 0);
+                push_arg(T0);
+            }
+        }
     }
-    write("\t### End of Actual Args");
+    else {
+        // a call in a later argument would overwrite $a0-$a3, so they are all pushed first
+        for(ASTNode* arg : *actual_args) {
+            arg->EmitValue(LT, 0);
+            push_arg(T0);
+        }
+        for(int i = 0; i < in_regs; i++) {
+            emit(Op::LW, (Register)(A0 + i), Mem(4 * (n - i), SP), "pass the argument in $a" + std::to_string(i));
+        }
+        for(int i = in_regs; i < n; i++) {
+            emit(Op::LW, T0, Mem(4 * (n - i), SP), "get the argument passed on the stack");
+            emit(Op::SW, T0, Mem(4 * (n - i + in_regs), SP), "move it over the ones passed in registers");
+        }
+        if(in_regs > 0) emit(Op::ADDI, SP, SP, Imm(4 * in_regs), "pop the arguments passed in registers");
+    }
+    comment("### End of Actual Args");
 }
 
 CallNode::CallNode(ASTNode* id, ASTNode* act_args, ErrorData err) 
@@ -949,6 +1410,9 @@ TypeInfo CallNode::getType() {
 }
 
 bool CallNode::TypeCheck() {
+    if(!actual_args->CheckArgs()) {
+        return false;
+    }
     std::vector<TypeInfo> args = actual_args->argTypes();
     std::string lexeme = identifier->getLexeme();
     FunctionInfo* funcInfo = static_cast<FunctionInfo*>(GlobalST->lookup(lexeme));
@@ -971,18 +1435,45 @@ bool CallNode::TypeCheck() {
             }
         }
     }
+    actual_args->Lend(funcInfo);
     return true;
 }
 
-void CallNode::EmitCode(LabelTracker& LT) {
-    write("\t### Call ###");
+ASTNode* CallNode::Fold() {
+    actual_args->Fold();
+    return this;
+}
+
+void CallNode::Call(LabelTracker& LT) {
+    comment("### Call ###");
     std::string lexeme = identifier->getLexeme();
-    actual_args->EmitCode(LT);
-    write("\tjal __%s\t\t# go to the function", lexeme.c_str());
+    int pushed = actual_args->getSize();
+    if(REG_ARGS) {
+        actual_args->EmitRegisters(LT);
+        pushed = std::max(pushed - NUM_ARG_REGS, 0);
+    }
+    else {
+        actual_args->EmitCode(LT);
+    }
+    emit(Op::JAL, Lbl("__" + lexeme), "go to the function");
+    if(pushed > 0) {
+        // the arguments are still on the stack above anything that was pushed before the call
+        emit(Op::ADDI, SP, SP, Imm(4*pushed), "pop the arguments");
+    }
+}
+
+void CallNode::EmitCode(LabelTracker& LT) {
+    Call(LT);
     // if the function returns something I want to put that on the stack
     // but if not then I need to leave the stack like it is...
-    push("$v0");
-    write("\t### End of Call ###");
+    if(!REG_ARGS || getType().type != Type::none) push(V0);
+    comment("### End of Call ###");
+}
+
+void CallNode::EmitValue(LabelTracker& LT, int reg) {
+    Call(LT);
+    emit(Op::MOVE, Temp(reg), V0, "get the return value");
+    comment("### End of Call ###");
 }
 
 ArrayAccessNode::ArrayAccessNode(ASTNode* id, ASTNode* expr, ErrorData err) 
@@ -1041,32 +1532,51 @@ void ArrayAccessNode::Initialize() {
     identifier->Initialize();
 }
 
-void ArrayAccessNode::Access(LabelTracker& LT) {
-    write("\t### Array Access ###");
-    expression->EmitCode(LT);
-    pop("$s0"); // array index
+int ArrayAccessNode::RegisterNeed() {
+    return std::max(expression->RegisterNeed(), 3);    // index, array and length
+}
+
+bool ArrayAccessNode::HasCall() {
+    return expression->HasCall();
+}
+
+ASTNode* ArrayAccessNode::Fold() {
+    expression = FoldNode(expression);
+    return this;
+}
+
+// leave the address of the element, minus the 4 bytes for the length, in Temp(reg)
+void ArrayAccessNode::Access(LabelTracker& LT, int reg) {
+    comment("### Array Access ###");
+    Register index = Temp(reg);
+    Register array = Temp(reg + 1);
+    Register length = Temp(reg + 2);
+    expression->EmitValue(LT, reg);
     int offset = LocalST->lookup(identifier->getLexeme())->GetOffset();
-    write("\tlw $t0, %d($fp)\t\t# $t0 = address of the array", offset);
-    write("\tlw $t1, ($t0)\t\t# get the length of the array");
+    emit(Op::LW, array, Mem(offset, FP), "get the address of the array");
+    emit(Op::LW, length, Mem(0, array), "get the length of the array");
     // check for out of bounds access
-    write("\tbge $s0, $t1, __error_outofbounds\t# out of bounds array access");
-    write("\tblt $s0, $zero, __error_outofbounds\t# negative array index error");
-    write("\taddi $t2, $s0, 1\t# add 1 to the index for the irrelavent first element");
-    write("\tsll $t2, $t2, 2\t\t# multiply $t2 by 4 to get byte size");
-    write("\tadd $t2, $t2, $t0\t# add the offset ($t2) to the beginning of the array ($t0)");
+    // a negative index is a large unsigned number, so one unsigned compare checks both ends
+    emit(Op::BGEU, index, length, Lbl("__error_outofbounds"), "out of bounds array access");
+    emit(Op::SLL, index, index, Imm(2), "multiply the index by 4 to get byte size");
+    emit(Op::ADD, index, index, array, "add the offset to the beginning of the array");
 }
 
 void ArrayAccessNode::EmitCode(LabelTracker& LT) {
     // access an element of an array
-    Access(LT);
-    write("\tlw $s1, ($t2)\t\t# get the element at given index");
-    push("$s1");
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void ArrayAccessNode::EmitValue(LabelTracker& LT, int reg) {
+    Access(LT, reg);
+    emit(Op::LW, Temp(reg), Mem(4, Temp(reg)), "get the element at given index, past the length");
 }
 
 void ArrayAccessNode::EmitSetCode(LabelTracker& LT) {
-    Access(LT);
-    pop("$t0");
-    write("\tsw $t0, ($t2)\t\t# set the element at given index");
+    Access(LT, 0);
+    pop(T1);
+    emit(Op::SW, T1, Mem(4, T0), "set the element at given index, past the length");
 }
 
 IfStatementNode::IfStatementNode(ASTNode* expr, ASTNode* if_, ASTNode* else_, ErrorData err) 
@@ -1130,11 +1640,16 @@ std::vector<ASTNode*> IfStatementNode::FindReturns() {
     return if_returns;
 }
 
+ASTNode* IfStatementNode::Fold() {
+    expression = FoldNode(expression);
+    if_branch->Fold();
+    if(else_branch) else_branch->Fold();
+    return this;
+}
+
 void IfStatementNode::EmitCode(LabelTracker& LT) {
-    write("\t### If Statement ###");
-    expression->EmitCode(LT);
-    pop("$s0");
-    LT.BranchElse("$s0");
+    comment("### If Statement ###");
+    LT.BranchElse(expression);
     if_branch->EmitCode(LT);
     LT.JumpEndIf();
     LT.ElseLabel();
@@ -1142,7 +1657,7 @@ void IfStatementNode::EmitCode(LabelTracker& LT) {
         else_branch->EmitCode(LT);
     }
     LT.EndIfLabel();
-    write("\t### end of If Statement ###");
+    comment("### end of If Statement ###");
 }
 
 WhileStatementNode::WhileStatementNode(ASTNode* expr, ASTNode* stmts, ErrorData err)
@@ -1187,16 +1702,20 @@ std::vector<ASTNode*> WhileStatementNode::FindReturns() {
     return body->FindReturns();
 }
 
+ASTNode* WhileStatementNode::Fold() {
+    expression = FoldNode(expression);
+    body->Fold();
+    return this;
+}
+
 void WhileStatementNode::EmitCode(LabelTracker& LT) {
-    write("\t### While Statement ###");
+    comment("### While Statement ###");
     LT.BeginWhileLabel();
-    expression->EmitCode(LT);
-    pop("$s0"); 
-    LT.BranchWhile("$s0");  // check the condition
+    LT.BranchWhile(expression);  // check the condition
     body->EmitCode(LT);
     LT.JumpBeginWhile();
     LT.EndWhileLabel();
-    write("\t### End While Statement ###");
+    comment("### End While Statement ###");
 }
 
 PrintStatementNode::PrintStatementNode(ASTNode* args, bool ln, ErrorData err)
@@ -1239,91 +1758,56 @@ bool PrintStatementNode::TypeCheck() {
     return check;
 }
 
-void PrintArray(Type type, LabelTracker& LT) {
-    pop("$s0"); // get the address of the beginning of the array
-    write("\tli $t0, 1\t\t# i = 1");
-    write("\tlw $t1, ($s0)\t\t# n = arr.len");
-    LT.Label("_printarr");
-    if(type == Type::array_bool) {
-        write("\tbgt $t0, $t1 _endprintarr%d", LT.counter+1);
-    }
-    else if(type == Type::array_i32 || type == Type::Str) {
-        write("\tbgt $t0, $t1 _endprintarr%d", LT.counter);
-    }
-    write("\tmul $t2, $t0, 4\t# offset = i * 4");
-    write("\tadd $t2, $t2, $s0\t\t# actual address in array");
-    write("\tlw $a0, ($t2)\t\t# load the element at index i");
-    if(type == Type::array_bool) {
-        write("\tla $a0, false   \t# load the 'false' message");
-        write("\tbeqz $t3, _printfalse%d   \t# don't load the 'true' message", LT.counter);
-        write("\tla $a0, true   \t# load the 'true' message");
-        LT.Label("_printfalse");
-        write("\tli $v0, 4      \t# print string service");
-        write("\tsyscall        \t# print the string");
-    }
-    else if(type == Type::array_i32) {
-        write("\tli $v0, 1 \t\t\t# print integer service");
-        write("\tsyscall   \t\t\t# print the number");
-    }
-    else if(type == Type::Str) {
-        write("\tli $v0, 11 \t\t\t# print character service");
-        write("\tsyscall   \t\t\t# print the character");
-    }
-    if(type != Type::Str) {
-        write("\tli $a0, 0x20  \t\t# load a space");
-        write("\tli $v0, 11    \t\t# print character service");
-        write("\tsyscall       \t\t# print the space");
-    }
-    write("\taddi $t0, $t0, 1\t\t# i++");
-    if(type == Type::array_bool) {
-        write("\tj _printarr%d", LT.counter-2);
-    }
-    else if(type == Type::array_i32 || type == Type::Str) {
-        write("\tj _printarr%d", LT.counter-1);
-    }
-    LT.Label("_endprintarr");
+// append a bool in $t0 to the output buffer
+static void PrintBool(Register value, LabelTracker& LT) {
+    emit(Op::LA, A0, Lbl("false"), "load the 'false' message");
+    emit(Op::BEQZ, value, Lbl("_printfalse", LT.counter), "don't load the 'true' message");
+    emit(Op::LA, A0, Lbl("true"), "load the 'true' message");
+    LT.Label("_printfalse");
+    emit(Op::JAL, Lbl("__puts"), "append the string");
+}
+
+// append a character to the output buffer
+static void PrintChar(int c, const std::string& comment) {
+    emit(Op::LI, A0, Imm(c), comment);
+    emit(Op::JAL, Lbl("__putc"), "append the character");
+}
+
+ASTNode* PrintStatementNode::Fold() {
+    actual_args->Fold();
+    return this;
 }
 
 void PrintStatementNode::EmitCode(LabelTracker& LT) {
-    write("\n\t### PrintStatement ###");
+    comment("### PrintStatement ###");
     for(ASTNode* arg : *(actual_args->getArgs())) {
         Type type = arg->getType().type;
-        arg->EmitCode(LT);
+        arg->EmitValue(LT, 0);
         if(type == Type::Bool) {
-            pop("$t0");     // get the result of the expression off of the stack
-            write("\tla $a0, false   \t# load the 'false' message");
-            write("\tbeqz $t0, _printfalse%d   \t# don't load the 'true' message", LT.counter);
-            write("\tla $a0, true   \t# load the 'true' message");
-            LT.Label("_printfalse");
-            write("\tli $v0, 4      \t# print string service");
-            write("\tsyscall        \t# print the string");
+            PrintBool(T0, LT);
         }
         else if(type == Type::i32) {
-            pop("$a0");
-            write("\tli $v0, 1 \t\t\t# print integer service");
-            write("\tsyscall   \t\t\t# print the number");
+            emit(Op::MOVE, A0, T0);
+            emit(Op::JAL, Lbl("__puti"), "append the number");
         }
         else if(type == Type::Char) {
-            pop("$a0");
-            write("\tli $v0, 11    \t\t# print character service");
-            write("\tsyscall       \t\t# print the character");
+            emit(Op::MOVE, A0, T0);
+            emit(Op::JAL, Lbl("__putc"), "append the character");
         }
         else if(type == Type::array_bool ||  type == Type::array_i32 || type == Type::Str) {
-            PrintArray(type, LT);
+            // the loops over the elements are runtime routines, called with the address of the array
+            emit(Op::MOVE, A0, T0);
+            if(type == Type::array_i32) emit(Op::JAL, Lbl("__print_array_i32"), "append the numbers");
+            else if(type == Type::array_bool) emit(Op::JAL, Lbl("__print_array_bool"), "append the bools");
+            else emit(Op::JAL, Lbl("__print_str"), "append the characters");
         }
-        write("\tli $a0, 0x20  \t\t# load a space");
-        write("\tli $v0, 11    \t\t# print character service");
-        write("\tsyscall       \t\t# print the space");
+        PrintChar(0x20, "load a space");
     }
-    write("\tli $a0, 0x20  \t\t# load a space");
-    write("\tli $v0, 11    \t\t# print character service");
-    write("\tsyscall       \t\t# print the space");
+    PrintChar(0x20, "load a space");
     if(newline) {
-        write("\tli $a0, 0xA  \t\t# load a newline");
-        write("\tli $v0, 11   \t\t# print character service");
-        write("\tsyscall       \t\t# print the newline");
+        PrintChar(0xA, "load a newline");
     }
-    write("\t### End of printstatement ###");
+    comment("### End of printstatement ###");
 }
 
 ReadNode::ReadNode(ErrorData err)
@@ -1335,10 +1819,19 @@ bool ReadNode::TypeCheck() {
 }
 
 void ReadNode::EmitCode(LabelTracker& LT) {
-    write("\t### Read ###");
-    write("\tli $v0, 5\t\t\t# read integer service");
-    write("\tsyscall");
-    push("$v0");
+    comment("### Read ###");
+    emit(Op::JAL, Lbl("__flush"), "show the output before waiting for input");
+    emit(Op::LI, V0, Imm(5), "read integer service");
+    emit(Op::SYSCALL);
+    push(V0);
+}
+
+void ReadNode::EmitValue(LabelTracker& LT, int reg) {
+    comment("### Read ###");
+    emit(Op::JAL, Lbl("__flush"), "show the output before waiting for input");
+    emit(Op::LI, V0, Imm(5), "read integer service");
+    emit(Op::SYSCALL);
+    emit(Op::MOVE, Temp(reg), V0, "get the integer that was read");
 }
 
 ReadNode::~ReadNode() {}
@@ -1374,12 +1867,26 @@ bool LengthNode::TypeCheck() {
     return true;
 }
 
+ASTNode* LengthNode::Fold() {
+    // a local array always has its declared size: assignments must match it
+    IdentifierInfo* info = static_cast<IdentifierInfo*>(LocalST->lookup(identifier->getLexeme()));
+    TypeInfo type = info->getReturnType();
+    if(info->IsLocal() && (type.type == Type::array_i32 || type.type == Type::array_bool) && type.size != UNKNOWN_ARR) {
+        return new NumberNode(type.size, err_data);
+    }
+    return this;
+}
+
 void LengthNode::EmitCode(LabelTracker& LT) {
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void LengthNode::EmitValue(LabelTracker& LT, int reg) {
     // get the length of the array reference by the identifier.
     int offset = LocalST->lookup(identifier->getLexeme())->GetOffset();
-    write("\tlw $t0, %d($fp)\t\t# $t0 = address of the array", offset);
-    write("\tlw $t1, ($t0)\t\t# get the length of the array");
-    push("$t1");
+    emit(Op::LW, Temp(reg), Mem(offset, FP), "get the address of the array");
+    emit(Op::LW, Temp(reg), Mem(0, Temp(reg)), "get the length of the array");
 }
 
 
@@ -1418,15 +1925,44 @@ bool UnaryNode::TypeCheck() {
     return true;
 }
 
+ASTNode* UnaryNode::Fold() {
+    right = FoldNode(right);
+    int value;
+    if(right->GetConstant(value)) {
+        if(op == "!") return new BoolNode(!value, err_data);
+        // negating the smallest integer overflows at runtime
+        if(op == "-" && value != INT_MIN) return new NumberNode(-value, err_data);
+        return this;
+    }
+    // !!b is b
+    UnaryNode* inner = dynamic_cast<UnaryNode*>(right);
+    if(op == "!" && inner && inner->op == "!") {
+        return Release(inner->right);
+    }
+    return this;
+}
+
 void UnaryNode::EmitCode(LabelTracker& LT) {
-    right->EmitCode(LT);
-    pop("$t0");
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void UnaryNode::EmitBranch(LabelTracker& LT, bool when, Operand target) {
     if(op == "!") {
-        write("\tnot $t2, $t0\t\t# not $t0");
+        right->EmitBranch(LT, !when, target);   // branch on the opposite of the operand
+        return;
+    }
+    ASTNode::EmitBranch(LT, when, target);
+}
+
+void UnaryNode::EmitValue(LabelTracker& LT, int reg) {
+    Register dest = Temp(reg);
+    right->EmitValue(LT, reg);
+    if(op == "!") {
+        emit(Op::SEQ, dest, dest, ZERO, "not");
     } else if(op == "-") {
-        write("\tneg $t2, $t0\t\t# negate $t0");
+        emit(Op::NEG, dest, dest, "negate");
     }
-    push("$t2");
 }
 
 
@@ -1492,60 +2028,238 @@ bool BinaryNode::TypeCheck() {
     return true;
 }
 
+int BinaryNode::RegisterNeed() {
+    int shift;
+    if(ASTNode* operand = ShiftOperand(shift)) return operand->RegisterNeed();
+    int l = left->RegisterNeed();
+    int r = right->RegisterNeed();
+    if(op == "&&" || op == "||") {
+        return std::max(l, r);      // the right side is only evaluated after the left side is tested
+    }
+    if(HasSideEffects()) {
+        return std::max(l, r + 1);  // the left side is always evaluated first
+    }
+    return l == r ? l + 1 : std::max(l, r);
+}
+
+bool BinaryNode::HasCall() {
+    return left->HasCall() || right->HasCall();
+}
+
+bool BinaryNode::HasSideEffects() {
+    // division can fail with a runtime error, so it is not moved around either
+    return left->HasSideEffects() || right->HasSideEffects() || op == "/" || op == "%";
+}
+
+ASTNode* BinaryNode::Fold() {
+    left = FoldNode(left);
+    right = FoldNode(right);
+    int l, r;
+    if(!(left->GetConstant(l) && right->GetConstant(r))) {
+        return Simplify();
+    }
+    long long a = l, b = r;
+    if(op == "+" || op == "-") {
+        long long result = op == "+" ? a + b : a - b;
+        // add and sub trap on overflow, so an overflowing expression is left for the runtime
+        if(result < INT_MIN || result > INT_MAX) return this;
+        return new NumberNode(result, err_data);
+    }
+    if(op == "*") {
+        return new NumberNode((int)((unsigned)l * (unsigned)r), err_data);   // mul wraps around
+    }
+    if(op == "/" || op == "%") {
+        // division by zero is a runtime error
+        if(r == 0 || (l == INT_MIN && r == -1)) return this;
+        return new NumberNode(op == "/" ? l / r : l % r, err_data);
+    }
+    bool result = false;
+    if(op == "&&") result = l && r;
+    else if(op == "||") result = l || r;
+    else if(op == "==") result = l == r;
+    else if(op == "!=") result = l != r;
+    else if(op == "<=") result = l <= r;
+    else if(op == ">=") result = l >= r;
+    else if(op == "<") result = l < r;
+    else if(op == ">") result = l > r;
+    return new BoolNode(result, err_data);
+}
+
+// an operand that may be dropped from the expression. Only variables are: any operation could fail at runtime
+static bool Droppable(ASTNode* operand) {
+    return dynamic_cast<IdentifierNode*>(operand) != nullptr;
+}
+
+ASTNode* BinaryNode::Simplify() {
+    int value;
+    if(right->GetConstant(value)) {
+        if((op == "+" || op == "-") && value == 0) return Release(left);
+        if((op == "*" || op == "/") && value == 1) return Release(left);
+        if(op == "*" && value == 0 && Droppable(left)) return Release(right);
+        if(op == "&&") return value ? Release(left) : Droppable(left) ? Release(right) : this;
+        if(op == "||") return value ? (Droppable(left) ? Release(right) : this) : Release(left);
+    }
+    else if(left->GetConstant(value)) {
+        if(op == "+" && value == 0) return Release(right);
+        if(op == "*" && value == 1) return Release(right);
+        if(op == "*" && value == 0 && Droppable(right)) return Release(left);
+        // the right side of && and || is not evaluated when the left side decides the result
+        if(op == "&&") return value ? Release(right) : Release(left);
+        if(op == "||") return value ? Release(left) : Release(right);
+    }
+    return this;
+}
+
+// the operand of a multiplication by a power of two, which is shifted left by shift instead
+ASTNode* BinaryNode::ShiftOperand(int& shift) {
+    if(op != "*") return nullptr;
+    int value;
+    ASTNode* operand = nullptr;
+    if(right->GetConstant(value)) operand = left;
+    else if(left->GetConstant(value)) operand = right;
+    if(!operand || value <= 0 || (value & (value - 1)) != 0) return nullptr;
+    for(shift = 0; (1 << shift) != value; shift++);
+    return operand;
+}
+
 void BinaryNode::EmitCode(LabelTracker& LT) {
-    // left side goes in $s0, right side goes in $s1
-    write("\t### Binary Node ###");
-    left->EmitCode(LT);
+    EmitValue(LT, 0);
+    push(T0);    // push the result onto the stack
+}
 
-    
-    // short circuit boolean evaluation:
-    pop("$t0"); // left operand
-    if(op == "&&") {
-        write("beqz $t0, _shortcircuit%d", LT.counter);
-    }
-    if(op == "||") {
-        write("bne $t0, $zero, _shortcircuit%d", LT.counter);
-    }
-    // I have a problem here. I need to back up the $t0 register before I call right's emit code
-    push("$t0");
-    right->EmitCode(LT);
-    pop("$t1"); // right operand
-    pop("$t0");
-    
+void BinaryNode::EmitValue(LabelTracker& LT, int reg) {
+    comment("### Binary Node ###");
+    Register dest = Temp(reg);
+    int shift;
+    if(ASTNode* operand = ShiftOperand(shift)) {
+        operand->EmitValue(LT, reg);
+        emit(Op::SLL, dest, dest, Imm(shift), "multiply by " + std::to_string(1 << shift));
+        comment("### end of Binary Node ###");
+        return;
+    }
+    if(op == "&&" || op == "||") {
+        // short circuit boolean evaluation: when the left side does not decide, the right side is the value
+        int shortcircuit = LT.counter++;
+        left->EmitValue(LT, reg);
+        emit(op == "&&" ? Op::BEQZ : Op::BNEZ, dest, Lbl("_shortcircuit", shortcircuit));
+        right->EmitValue(LT, reg);
+        label(Lbl("_shortcircuit", shortcircuit));
+        comment("### end of Binary Node ###");
+        return;
+    }
+    Register l, r;
+    EmitOperands(LT, reg, l, r);
+    EmitOperation(dest, l, r);
+    comment("### end of Binary Node ###");
+}
+
+// evaluate both sides into registers, starting at Temp(reg)
+void BinaryNode::EmitOperands(LabelTracker& LT, int reg, Register& l, Register& r) {
+    // evaluate the side that needs more registers first if the order can't be observed
+    bool swap = !HasSideEffects() && right->RegisterNeed() > left->RegisterNeed();
+    ASTNode* first = swap ? right : left;
+    ASTNode* second = swap ? left : right;
+    first->EmitValue(LT, reg);
+
+    Register first_reg = Temp(reg);
+    Register second_reg = Temp(reg + 1);
+    if(second->HasCall() || reg + 1 + second->RegisterNeed() > NUM_TEMPS) {
+        // the first value would not survive the call, or there are not enough registers left
+        push(first_reg);
+        second->EmitValue(LT, reg);
+        first_reg = Temp(reg + 1);
+        second_reg = Temp(reg);
+        pop(first_reg);
+    }
+    else {
+        second->EmitValue(LT, reg + 1);
+    }
+    l = swap ? second_reg : first_reg;
+    r = swap ? first_reg : second_reg;
+}
+
+/*
+    Jumping code for conditions: a comparison branches on its operands
+    with a single instruction instead of setting a register to 0 or 1
+    and testing it, and && and || branch out as soon as one side decides.
+    The branch is taken when the condition is equal to when.
+*/
+void BinaryNode::EmitBranch(LabelTracker& LT, bool when, Operand target) {
+    if(op == "&&" || op == "||") {
+        bool decides = op == "||";  // the value of the left side that decides the whole condition
+        if(when == decides) {
+            left->EmitBranch(LT, when, target);
+            right->EmitBranch(LT, when, target);
+        }
+        else {
+            Operand shortcircuit = Lbl("_shortcircuit", LT.counter++);
+            left->EmitBranch(LT, decides, shortcircuit);
+            right->EmitBranch(LT, when, target);
+            label(shortcircuit);
+        }
+        return;
+    }
+    Op branch = BranchOp(when);
+    if(branch == Op::COMMENT) {
+        ASTNode::EmitBranch(LT, when, target);
+        return;
+    }
+    comment("### Compare and Branch ###");
+    int value;
+    if(right->GetConstant(value)) {
+        left->EmitValue(LT, 0);
+        emit(branch, T0, Imm(value), target, "compare with the constant");
+    }
+    else {
+        Register l, r;
+        EmitOperands(LT, 0, l, r);
+        emit(branch, l, r, target, "compare the left and right sides");
+    }
+}
+
+// the branch taken when the comparison is equal to when, COMMENT if op is not a comparison
+Op BinaryNode::BranchOp(bool when) {
+    static const std::unordered_map<std::string, std::pair<Op, Op>> branches = {
+        {"==", {Op::BEQ, Op::BNE}}, {"!=", {Op::BNE, Op::BEQ}},
+        {"<", {Op::BLT, Op::BGE}}, {">=", {Op::BGE, Op::BLT}},
+        {">", {Op::BGT, Op::BLE}}, {"<=", {Op::BLE, Op::BGT}},
+    };
+    auto found = branches.find(op);
+    if(found == branches.end()) return Op::COMMENT;
+    return when ? found->second.first : found->second.second;
+}
+
+// dest = l op r
+void BinaryNode::EmitOperation(Register dest, Register l, Register r) {
     if(op == "+") {
-        write("\tadd $t2, $t0, $t1\t# add the left and right sides");
+        emit(Op::ADD, dest, l, r, "add the left and right sides");
     } else if(op == "-") {
-        write("\tsub $t2, $t0, $t1\t# subtract the left and right sides");
+        emit(Op::SUB, dest, l, r, "subtract the left and right sides");
     } else if(op == "*") {
-        write("\tmul $t2, $t0, $t1\t# multiply the left and right sides");
+        emit(Op::MUL, dest, l, r, "multiply the left and right sides");
     } else if(op == "/") {
-        write("\tbeqz $s1, __error_div0\t# jump to the division by zero runtime error");
-        write("\tdiv $t2, $t0, $t1\t# divide the left and right sides");
+        emit(Op::BEQZ, r, Lbl("__error_div0"), "jump to the division by zero runtime error");
+        emit(Op::DIV, dest, l, r, "divide the left and right sides");
     } else if(op == "%") {
-        write("\tbeqz $s1, __error_div0\t# jump to the division by zero runtime error");
-        write("\trem $t2, $t0, $t1\t# get the remainder from dividing $t0 by $t1");
+        emit(Op::BEQZ, r, Lbl("__error_div0"), "jump to the division by zero runtime error");
+        emit(Op::REM, dest, l, r, "get the remainder from dividing the left by the right side");
     } else if(op == "&&") {
-        write("\tand $t2, $t0, $t1\t# and left and right side");
+        emit(Op::AND, dest, l, r, "and left and right side");
     } else if(op == "||") {
-        write("\tor  $t2, $t0, $t1\t# or left and right side");
+        emit(Op::OR, dest, l, r, "or left and right side");
     } else if(op == "==") {
-        write("\tseq  $t2, $t0, $t1\t# equal");
+        emit(Op::SEQ, dest, l, r, "equal");
     } else if(op == "!=") {
-        write("\tsne  $t2, $t0, $t1\t# not equal");
+        emit(Op::SNE, dest, l, r, "not equal");
     } else if(op == "<=") {
-        write("\tsle  $t2, $t0, $t1\t# less than or equal");
+        emit(Op::SLE, dest, l, r, "less than or equal");
     } else if(op == ">=") {
-        write("\tsge  $t2, $t0, $t1\t# greater or equal");
+        emit(Op::SGE, dest, l, r, "greater or equal");
     } else if(op == "<") {
-        write("\tslt  $t2, $t0, $t1\t# less than");
+        emit(Op::SLT, dest, l, r, "less than");
     } else if(op == ">") {
-        write("\tsgt  $t2, $t0, $t1\t# greater than");
-    }
-    if(op == "&&" || op == "||") {
-        LT.Label("_shortcircuit");
+        emit(Op::SGT, dest, l, r, "greater than");
     }
-    push("$t2");    // push the result onto the stack again.
-    write("\t### end of Binary Node ###");
 }
 
 
@@ -1601,27 +2315,56 @@ void IdentifierNode::setLocalST(SymbolTable* ST) {
     LocalST = ST;
 }
 
+void IdentifierNode::Escape() {
+    SymbolInfo* info = LocalST->lookup(lexeme);
+    if(!info) return;
+    Type type = info->getReturnType().type;
+    if(type == Type::array_bool || type == Type::array_i32) info->Escape();
+}
+
+void IdentifierNode::Replace() {
+    SymbolInfo* info = LocalST->lookup(lexeme);
+    if(!info) return;
+    Type type = info->getReturnType().type;
+    if(type == Type::array_bool || type == Type::array_i32) info->Replace();
+}
+
+void IdentifierNode::Lend(FunctionInfo* func, int param) {
+    SymbolInfo* info = LocalST->lookup(lexeme);
+    if(!info) return;
+    Type type = info->getReturnType().type;
+    if(type == Type::array_bool || type == Type::array_i32) info->Lend(func, param);
+}
+
 void IdentifierNode::EmitCode(LabelTracker& LT) {
     SymbolInfo* info = LocalST->lookup(lexeme);
     assert(info);
     int offset = info->GetOffset();
-    write("\tlw $t0, %d($fp)\t\t# get the value of '%s'", offset, lexeme.c_str());
-    push("$t0");
+    emit(Op::LW, T0, Mem(offset, FP), "get the value of '" + lexeme + "'");
+    push(T0);
+}
+
+void IdentifierNode::EmitValue(LabelTracker& LT, int reg) {
+    SymbolInfo* info = LocalST->lookup(lexeme);
+    assert(info);
+    emit(Op::LW, Temp(reg), Mem(info->GetOffset(), FP), "get the value of '" + lexeme + "'");
 }
 
 void IdentifierNode::EmitSetCode(LabelTracker& LT) {
     SymbolInfo* info = LocalST->lookup(lexeme);
     assert(info);
     int offset = info->GetOffset();
-    pop("$s0");
     Type type = info->getReturnType().type;
     // if we are assigning to an array identifier using an array literal
-    // then we need to free the old pointer and point to the new array
-    if(type == Type::array_bool || type == Type::array_i32) {
-        write("\tlw $a0, %d($fp)\t\t# get the old array pointer", offset);
-        write("\tjal free\t\t# free the old pointer");
+    // then we need to free the old pointer and point to the new array.
+    // The new value stays on the stack while free runs. An array another
+    // variable may still point to is left alone.
+    if((type == Type::array_bool || type == Type::array_i32) && !info->Shared()) {
+        emit(Op::LW, A0, Mem(offset, FP), "get the old array pointer");
+        emit(Op::JAL, Lbl("free"), "free the old pointer");
     }
-    write("\tsw $s0, %d($fp)\t\t# set the value of '%s'", offset, lexeme.c_str());
+    pop(T0);
+    emit(Op::SW, T0, Mem(offset, FP), "set the value of '" + lexeme + "'");
 }
 
 TypeNode::TypeNode(TypeInfo t, ErrorData err) 
@@ -1646,8 +2389,12 @@ int NumberNode::getValue() {
 }
 
 void NumberNode::EmitCode(LabelTracker& LT) {
-    write("\tli, $t0, %d\t\t\t# load the value of the number", value);
-    push("$t0");
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void NumberNode::EmitValue(LabelTracker& LT, int reg) {
+    emit(Op::LI, Temp(reg), Imm(value), "load the value of the number");
 }
 
 BoolNode::BoolNode(bool val, ErrorData err)
@@ -1662,13 +2409,17 @@ bool BoolNode::getValue() {
 }
 
 void BoolNode::EmitCode(LabelTracker& LT) {
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void BoolNode::EmitValue(LabelTracker& LT, int reg) {
     if(value) {
-        write("\tli, $t0, 1\t\t\t# loading 'true'");
+        emit(Op::LI, Temp(reg), Imm(1), "loading 'true'");
     }
     else {
-        write("\tli, $t0, 0\t\t\t# loading 'false'");
+        emit(Op::LI, Temp(reg), Imm(0), "loading 'false'");
     }
-    push("$t0");
 }
 
 CharNode::CharNode(std::string val, ErrorData err)
@@ -1683,9 +2434,13 @@ char CharNode::getValue() {
     return value;
 }
 void CharNode::EmitCode(LabelTracker& LT) {
-    write("\t### CharNode ###");
-    write("\tli, $t0, '%c'\t\t\t# loading character", value);
-    push("$t0");
+    EmitValue(LT, 0);
+    push(T0);
+}
+
+void CharNode::EmitValue(LabelTracker& LT, int reg) {
+    comment("### CharNode ###");
+    emit(Op::LI, Temp(reg), Imm(value), std::string("loading character '") + value + "'");
 }
 
 StringNode::StringNode(std::string val, ErrorData err)
@@ -1700,20 +2455,12 @@ StringNode::~StringNode() {}
 
 void StringNode::EmitCode(LabelTracker& LT) {
     std::cout << "Emitting code for StringNode\n";
-    // TODO: put the characters in the string into an array of characters
     // 1. determine amount of space needed
     int space = 4*(value.size() + 1);
     // 2. allocate space on the heap
-    write("\tli, $a0, %d\t\t# request %d bytes from malloc", space, space);
-    write("\tjal malloc");
-    // 3. Store the size of the string in the first word of the array
-    write("\tli $t0, %d\t# size of array", value.size());
-    write("\tsw $t0, ($v0)\t# put the number of elements in the start of the array");
-    // 4. put all the other characters into the array
-    for(size_t i=0; i < value.size(); i++) {
-        write("\tli $t0, '%c'\t\t# load the character", value[i]);
-        // put the value into the array at index i+1
-        write("\tsw $t0, %d($v0)\t\t# place the value into the array", 4*(i+1));
-    }
-    push("$v0");
+    emit(Op::LI, A0, Imm(space), "request " + std::to_string(space) + " bytes from malloc");
+    emit(Op::JAL, Lbl("malloc"));
+    // 3. copy the size of the string and its characters into the array
+    copy_literal(std::vector<int>(value.begin(), value.end()), V0, LT);
+    push(V0);
 }
\ No newline at end of file
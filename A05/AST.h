@@ -10,6 +10,14 @@ Define the classes used in the Abstract Syntax Tree for Rustish
 Every ASTNode has a type, a line number, and a pointer to its local and global symbol table
 The Program owns the global symbol table, and each function owns its own local symbol table
 The owners of the symbol tables create them and share them with their children using setLocalST
+After type checking Fold() replaces constant subexpressions by their values, keeping the
+expressions that would overflow or divide by zero at runtime so they still raise their errors.
+Expressions are evaluated into the temporary registers $t0-$t9 with Sethi-Ullman numbering:
+RegisterNeed() is the number of registers a subtree needs, and EmitValue(LT, reg) evaluates it into
+Temp(reg) using only Temp(reg) and up. Values only go through the stack when the registers run out
+or when they have to survive a call.
+The conditions of if and while are compiled by EmitBranch(LT, when, target) into jumping code, which
+branches on the comparisons directly and leaves && and || as soon as one side decides.
 
 */
 #pragma once
@@ -18,7 +26,9 @@ The owners of the symbol tables create them and share them with their children u
 #include "SymbolTable.h"
 #include <iostream>
 #include "ErrorData.h"
+#include "Emitter.h"
 #include <stack> // Include stack for std::stack
+#include <unordered_map>
 
 struct OpType {
     TypeInfo op_type;
@@ -53,8 +63,14 @@ static OpType GetOpType(std::string op) {
     else return OpType(Type::none, Type::none);
 }
 
-void begin_func(std::string name);
-void end_func(std::string name);
+const int NUM_TEMPS = 10;   // $t0-$t9 hold the values of expressions
+Register Temp(int reg);     // the reg'th temporary register
+
+void begin_func(std::string name, int locals);
+void end_func();
+void finish_func(InstrList* list);
+
+class ASTNode;
 
 struct LabelTracker {
     int if_count;       // stacked counter for nested ifs
@@ -64,12 +80,12 @@ struct LabelTracker {
     int counter;        // basic counter for all other needs
     LabelTracker();
     void Label(const char* l);
-    void BranchElse(const char* reg);
+    void BranchElse(ASTNode* condition);
     void JumpEndIf();
     void EndIfLabel();
     void ElseLabel();
     void BeginWhileLabel();
-    void BranchWhile(const char* reg);
+    void BranchWhile(ASTNode* condition);
     void JumpBeginWhile();
     void EndWhileLabel();
 };
@@ -88,6 +104,11 @@ class ASTNode {
         virtual void setLocalST(SymbolTable* ST) {};
         virtual bool TypeCheck() { return true; };
         virtual std::vector<ASTNode*> FindReturns() {return {};}
+        virtual ASTNode* Fold() { return this; }                // fold constant expressions, returns the node that replaces this one
+        virtual bool GetConstant(int& value) { return false; }  // the value of a constant expression
+        virtual void Escape() {}                                // the array the expression names outlives the statement
+        virtual void Replace() { Escape(); }                    // the array is replaced by one nothing else points to
+        virtual void Lend(FunctionInfo* func, int param) { Escape(); }  // the array is passed as the given parameter of a call
 
         virtual void setType(TypeInfo t) {
             _type = t;
@@ -96,6 +117,13 @@ class ASTNode {
             return _type;
         }
         virtual void EmitCode(LabelTracker&) = 0;
+
+        // code generation for expressions
+        virtual int RegisterNeed() { return 1; }            // the Sethi-Ullman number of the expression
+        virtual bool HasCall() { return false; }            // a call overwrites all the temporary registers
+        virtual bool HasSideEffects() { return HasCall(); } // the expression can't be evaluated out of order
+        virtual void EmitValue(LabelTracker& LT, int reg);  // evaluate the expression into Temp(reg)
+        virtual void EmitBranch(LabelTracker& LT, bool when, Operand target);  // jump to target if the value is when
 };
 
 class NumberNode: public ASTNode {
@@ -105,7 +133,9 @@ class NumberNode: public ASTNode {
         NumberNode(int value, ErrorData err);
         ~NumberNode();
         int getValue();
+        bool GetConstant(int& v) override { v = value; return true; }
         void EmitCode(LabelTracker&) override; // Emit code for a number literal
+        void EmitValue(LabelTracker& LT, int reg) override;
 };
 
 class BoolNode: public ASTNode {
@@ -115,7 +145,9 @@ class BoolNode: public ASTNode {
         BoolNode(bool value, ErrorData err);
         ~BoolNode();
         bool getValue();
+        bool GetConstant(int& v) override { v = value; return true; }
         void EmitCode(LabelTracker&) override; // Emit code for a boolean literal
+        void EmitValue(LabelTracker& LT, int reg) override;
 };
 
 class CharNode: public ASTNode {
@@ -125,7 +157,9 @@ class CharNode: public ASTNode {
         CharNode(std::string val, ErrorData err);
         ~CharNode();
         char getValue();
+        bool GetConstant(int& v) override { v = value; return true; }
         void EmitCode(LabelTracker&) override;
+        void EmitValue(LabelTracker& LT, int reg) override;
 };
 
 class StringNode: public ASTNode {
@@ -134,6 +168,7 @@ class StringNode: public ASTNode {
     public:
         StringNode(std::string val, ErrorData err);
         ~StringNode();
+        bool HasCall() override { return true; }    // calls malloc
         void EmitCode(LabelTracker&) override;
 };
 
@@ -152,8 +187,14 @@ class ArrayLiteralNode: public ASTNode {
         ArrayLiteralNode(ASTNode* expression, ErrorData err);
         ~ArrayLiteralNode();
         void append(ASTNode* expression);
+        void setGlobalST(SymbolTable* ST) override;
+        void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
+        bool HasCall() override { return true; }    // calls malloc
+        ASTNode* Fold() override;
+        bool GetValues(std::vector<int>& values);   // the elements of a literal of constants
         void EmitCode(LabelTracker&) override; // Emit code for an array literal
+        void EmitInPlace(LabelTracker& LT, int offset); // fill the array the slot at offset points to
 };
 
 class LValueNode: public ASTNode {
@@ -178,7 +219,11 @@ class IdentifierNode: public LValueNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         void Initialize() override;
+        void Escape() override;
+        void Replace() override;
+        void Lend(FunctionInfo* func, int param) override;
         void EmitCode(LabelTracker&) override; // Emit code for an identifier
+        void EmitValue(LabelTracker& LT, int reg) override;
         void EmitSetCode(LabelTracker&) override;   // Emit code for set identifier value
 };
 
@@ -195,9 +240,14 @@ class ArrayAccessNode: public LValueNode {
         bool TypeCheck() override;
         std::string getLexeme() override;
         void Initialize() override;
+        int RegisterNeed() override;
+        bool HasCall() override;
+        bool HasSideEffects() override { return true; }     // can fail the bounds check
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for get array access
+        void EmitValue(LabelTracker& LT, int reg) override;
         void EmitSetCode(LabelTracker&) override;   // Emit code for set array access
-        void Access(LabelTracker&);
+        void Access(LabelTracker&, int reg);
 };
 
 class VarDeclNode: public ASTNode {
@@ -209,9 +259,11 @@ class VarDeclNode: public ASTNode {
         ~VarDeclNode();
         bool TypeCheck() override;
         void Initialize();
+        std::string getLexeme() { return identifier->getLexeme(); }
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         void EmitCode(LabelTracker&) override; // Emit code for variable declaration
+        void SetOffset(int offset);     // move the variable to another word relative to $fp
 };
 
 class ArrayDeclNode: public ASTNode {
@@ -238,6 +290,9 @@ class AssignmentStatementNode: public ASTNode {
         bool TypeCheck() override;
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
+        ASTNode* Fold() override;
+        SymbolInfo* LiteralTarget();            // the local array a literal is assigned to
+        bool InPlace();                         // the literal on the right fills the array on the left
         void EmitCode(LabelTracker&) override; // Emit code for assignment statement
 };
 
@@ -252,6 +307,7 @@ class StatementListNode: public ASTNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         std::vector<ASTNode*> FindReturns() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for a list of statements
 };
 
@@ -279,6 +335,7 @@ class MainDefNode: public ASTNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for the main function
 };
 
@@ -293,6 +350,8 @@ class ParamsListNode: public ASTNode {
         std::vector<TypeInfo> getTypes();   // return the types of the parameters
         void setLocalST(SymbolTable* ST) override;
         int getSize() { return parameters->size(); }
+        std::vector<SymbolInfo*> getInfos();    // the parameters in the local symbol table
+        void ReadInPlace(int first);    // the parameters from first on are read where the caller pushed them
         // note: the parameters of a function do not need a global symbol table
         bool TypeCheck() override;      // populate the parameters into the local symbol table
         void EmitCode(LabelTracker&) override; // Emit code for parameters list
@@ -312,6 +371,7 @@ class FuncDefNode: public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
         bool CheckReturn();
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for function definition
 };
 
@@ -326,6 +386,7 @@ class ReturnNode: public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
         std::vector<ASTNode*> FindReturns() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for return statement
 };
 
@@ -341,8 +402,12 @@ class ActualArgsNode: public ASTNode {
         std::vector<ASTNode*>* getArgs() { return actual_args; }
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
+        bool CheckArgs();                       // type check the arguments of a call
         std::vector<TypeInfo> argTypes();
+        ASTNode* Fold() override;
+        void Lend(FunctionInfo* func);          // the arrays are passed to the parameters of func
         void EmitCode(LabelTracker&) override; // Emit code for actual arguments
+        void EmitRegisters(LabelTracker&);      // pass the first arguments in $a0-$a3 and push the others
 };
 
 class CallNode: public ASTNode {
@@ -356,7 +421,11 @@ class CallNode: public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         TypeInfo getType() override;
         bool TypeCheck() override;
+        bool HasCall() override { return true; }
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for function call
+        void EmitValue(LabelTracker& LT, int reg) override;
+        void Call(LabelTracker&);
 };
 
 class IfStatementNode: public ASTNode {
@@ -371,6 +440,7 @@ class IfStatementNode: public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
         std::vector<ASTNode*> FindReturns() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for if statement
 };
 
@@ -385,6 +455,7 @@ class WhileStatementNode: public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
         std::vector<ASTNode*> FindReturns() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for while statement
 };
 
@@ -398,6 +469,7 @@ class PrintStatementNode: public ASTNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for print statement
 };
 
@@ -406,7 +478,10 @@ class ReadNode: public ASTNode {
         ReadNode(ErrorData err);
         ~ReadNode();
         bool TypeCheck() override;
+        bool HasCall() override { return true; }            // flushes the output buffer first
+        bool HasSideEffects() override { return true; }     // reads the input
         void EmitCode(LabelTracker&) override;
+        void EmitValue(LabelTracker& LT, int reg) override;
 };
 
 class LengthNode: public ASTNode {
@@ -418,7 +493,9 @@ class LengthNode: public ASTNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
+        ASTNode* Fold() override;      // the length of a local array with a known size
         void EmitCode(LabelTracker&) override;
+        void EmitValue(LabelTracker& LT, int reg) override;
 };
 
 class UnaryNode : public ASTNode {
@@ -431,7 +508,13 @@ class UnaryNode : public ASTNode {
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
+        int RegisterNeed() override { return right->RegisterNeed(); }
+        bool HasCall() override { return right->HasCall(); }
+        bool HasSideEffects() override { return right->HasSideEffects(); }
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for unary operation
+        void EmitValue(LabelTracker& LT, int reg) override;
+        void EmitBranch(LabelTracker& LT, bool when, Operand target) override;
 };
 
 class BinaryNode : public ASTNode {
@@ -446,7 +529,18 @@ class BinaryNode : public ASTNode {
         void setLocalST(SymbolTable* ST) override;
         bool TypeCheck() override;
         bool BoolInt(TypeInfo t);
+        int RegisterNeed() override;
+        bool HasCall() override;
+        bool HasSideEffects() override;
+        ASTNode* Fold() override;
+        ASTNode* Simplify();            // algebraic identities with one constant operand
+        ASTNode* ShiftOperand(int& shift);
         void EmitCode(LabelTracker&) override; // Emit code for binary operation
+        void EmitValue(LabelTracker& LT, int reg) override;
+        void EmitOperands(LabelTracker& LT, int reg, Register& l, Register& r);
+        void EmitBranch(LabelTracker& LT, bool when, Operand target) override;
+        Op BranchOp(bool when);
+        void EmitOperation(Register dest, Register l, Register r);
 };
 
 class FuncDefListNode: public ASTNode {
@@ -459,6 +553,7 @@ class FuncDefListNode: public ASTNode {
         bool TypeCheck() override;
         void setGlobalST(SymbolTable* ST) override;
         // note: the list of function def's do not exist in a local symbol table 
+        ASTNode* Fold() override;
         void EmitCode(LabelTracker&) override; // Emit code for function definitions list
 };
 
@@ -468,7 +563,7 @@ class ProgramNode : public ASTNode {
         MainDefNode* main_def;
         FuncDefListNode* func_def_list;
     public:
-        ProgramNode(ASTNode* func_list, ASTNode* main, FILE* fdout);
+        ProgramNode(ASTNode* func_list, ASTNode* main, Emitter* emitter, bool reg_args, bool debug_heap, bool regions);
         ~ProgramNode();
         void setGlobalST(SymbolTable* ST) override;
         void setLocalST(SymbolTable* ST) override;
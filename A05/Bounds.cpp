@@ -0,0 +1,494 @@
+/*
+Bounds.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the range analysis of array indices, check removal and loop versioning
+*/
+
+#include "Bounds.h"
+#include "Cfg.h"
+#include "Ssa.h"
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+
+static const int MAX_DEPTH = 6;             // how many phi nodes a proof may look through
+static const int MAX_VERSIONED = 256;       // longest loop that is copied
+static const int MAX_ADJUST = 1 << 15;      // largest constant added to a length in a test
+
+// a value as a base plus a constant
+struct Sym {
+    enum Base { NONE, CONST, VALUE, LEN };  // NONE for a value that is not known
+    Base base = NONE;
+    int id = -1;        // the SSA value, or the SSA value of the array pointer for LEN
+    long offset = 0;    // the constant, or the value of a constant
+    bool SameBase(const Sym& other) const { return base == other.base && id == other.id; }
+};
+
+static Sym Const(long value) {
+    return {Sym::CONST, -1, value};
+}
+
+static Sym Plus(Sym sym, long c) {
+    if(sym.base != Sym::NONE) sym.offset += c;
+    return sym;
+}
+
+// a comparison computed into a register
+struct Cond {
+    Op rel = Op::COMMENT;   // SLT, SLE, SGT, SGE, SEQ, SNE, or COMMENT if the register holds none
+    Sym l, r;
+};
+
+// a < b
+struct Fact {
+    Sym a, b;
+};
+
+struct Check {
+    int instr;
+    Sym index, length;
+    std::vector<Fact> facts;    // the facts that hold before the check
+};
+
+static Op Negate(Op rel) {
+    switch(rel) {
+        case Op::SLT: return Op::SGE;
+        case Op::SGE: return Op::SLT;
+        case Op::SLE: return Op::SGT;
+        case Op::SGT: return Op::SLE;
+        case Op::SEQ: return Op::SNE;
+        case Op::SNE: return Op::SEQ;
+        default: return Op::COMMENT;
+    }
+}
+
+static void AddFacts(Cond cond, bool holds, std::vector<Fact>& facts) {
+    Op rel = holds ? cond.rel : Negate(cond.rel);
+    Sym l = cond.l, r = cond.r;
+    if(l.base == Sym::NONE || r.base == Sym::NONE) return;
+    switch(rel) {
+        case Op::SLT: facts.push_back({l, r}); break;
+        case Op::SLE: facts.push_back({l, Plus(r, 1)}); break;
+        case Op::SGT: facts.push_back({r, l}); break;
+        case Op::SGE: facts.push_back({r, Plus(l, 1)}); break;
+        case Op::SEQ:
+            facts.push_back({l, Plus(r, 1)});
+            facts.push_back({r, Plus(l, 1)});
+            break;
+        default: break;
+    }
+}
+
+// the relation a branch tests when it is taken
+static Cond BranchCond(const Instruction& instr, const std::vector<Sym>& regs, const std::vector<Cond>& conds) {
+    auto sym = [&](const Operand& o) { return o.kind == Operand::IMM ? Const(o.value) : regs[o.reg]; };
+    switch(instr.op) {
+        case Op::BEQZ: return {Negate(conds[instr.a.reg].rel), conds[instr.a.reg].l, conds[instr.a.reg].r};
+        case Op::BNEZ: return conds[instr.a.reg];
+        case Op::BLT: return {Op::SLT, sym(instr.a), sym(instr.b)};
+        case Op::BLE: return {Op::SLE, sym(instr.a), sym(instr.b)};
+        case Op::BGT: return {Op::SGT, sym(instr.a), sym(instr.b)};
+        case Op::BGE: return {Op::SGE, sym(instr.a), sym(instr.b)};
+        case Op::BEQ: return {Op::SEQ, sym(instr.a), sym(instr.b)};
+        case Op::BNE: return {Op::SNE, sym(instr.a), sym(instr.b)};
+        default: return {};
+    }
+}
+
+static bool IsBoundsCheck(const Instruction& instr) {
+    return instr.op == Op::BGEU && LabelName(instr.c.value) == "__error_outofbounds";
+}
+
+class RangeAnalysis {
+    public:
+        const InstrList& list;
+        Cfg cfg;
+        Ssa ssa;
+        std::vector<Sym> syms;                      // the symbolic value of each SSA value
+        std::vector<std::vector<Fact>> facts_end;   // the facts at the end of each block
+        std::vector<Check> checks;
+
+        explicit RangeAnalysis(const InstrList& list);
+        bool Less(Sym a, Sym b, const std::vector<Fact>& facts, int depth = 0) const;
+        bool InRange(const Check& check) const;
+        bool Invariant(Sym sym, int header) const;
+        int Reaching(int block, int slot) const;
+    private:
+        std::vector<Cond> exit_conds;               // the relation tested by the branch ending each block
+
+        void Visit(int b);
+        int DefBlock(int v) const;
+};
+
+RangeAnalysis::RangeAnalysis(const InstrList& list) : list(list), cfg(list), ssa(list, cfg) {
+    syms.resize(ssa.values.size());
+    for(int v = 0; v < (int)syms.size(); v++) syms[v] = {Sym::VALUE, v, 0};
+    facts_end.resize(cfg.blocks.size());
+    exit_conds.resize(cfg.blocks.size());
+    // a definition dominates its uses, so it is always visited first
+    for(int b : cfg.order) Visit(b);
+}
+
+void RangeAnalysis::Visit(int b) {
+    const BasicBlock& block = cfg.blocks[b];
+    const std::vector<Instruction>& code = list.code;
+    std::vector<Fact> facts;
+    if(b != 0) {
+        int idom = block.idom;
+        facts = facts_end[idom];
+        const BasicBlock& dom = cfg.blocks[idom];
+        // the branch that leads here is a fact when it is the only way in
+        if(block.preds.size() == 1 && exit_conds[idom].rel != Op::COMMENT) {
+            bool taken = BranchTarget(code[dom.end - 1], cfg.labels) == block.begin;
+            bool falls = idom + 1 == b && code[dom.end - 1].op != Op::J;
+            if(taken != falls) AddFacts(exit_conds[idom], taken, facts);
+        }
+    }
+
+    std::vector<Sym> regs(NUM_REGS);
+    std::vector<Cond> conds(NUM_REGS);
+    regs[ZERO] = Const(0);
+    // the words pushed for temporaries, by their address relative to $sp at the start of the block
+    int sp = 0;
+    std::unordered_map<int, std::pair<Sym, Cond>> pushed;
+    auto sym = [&](const Operand& o) {
+        if(o.kind == Operand::IMM) return Const(o.value);
+        return o.kind == Operand::REG ? regs[o.reg] : Sym();
+    };
+    for(int i = block.begin; i < block.end; i++) {
+        const Instruction& instr = code[i];
+        if(instr.op == Op::ADDI && instr.a.reg == SP && instr.b.reg == SP) {
+            sp += instr.c.value;
+            continue;
+        }
+        if(instr.op == Op::SW && instr.b.reg == SP) {
+            pushed[sp + instr.b.value] = {regs[instr.a.reg], conds[instr.a.reg]};
+            continue;
+        }
+        if(instr.op == Op::LW && instr.b.reg == SP) {
+            auto found = pushed.find(sp + instr.b.value);
+            regs[instr.a.reg] = found == pushed.end() ? Sym() : found->second.first;
+            conds[instr.a.reg] = found == pushed.end() ? Cond() : found->second.second;
+            continue;
+        }
+        if(ssa.slot_of[i] >= 0 && instr.op == Op::SW) {
+            if(ssa.value_of[i] >= 0 && regs[instr.a.reg].base != Sym::NONE) syms[ssa.value_of[i]] = regs[instr.a.reg];
+            continue;
+        }
+        if(instr.op == Op::SW) {
+            pushed.clear();     // a store through a pointer
+            continue;
+        }
+        if(IsBoundsCheck(instr)) {
+            checks.push_back({i, regs[instr.a.reg], regs[instr.b.reg], facts});
+            // past the check the index is in range
+            facts.push_back({Const(-1), regs[instr.a.reg]});
+            facts.push_back({regs[instr.a.reg], regs[instr.b.reg]});
+            continue;
+        }
+        if(instr.op == Op::JAL) {
+            pushed.clear();
+            std::fill(regs.begin() + 1, regs.end(), Sym());
+            std::fill(conds.begin(), conds.end(), Cond());
+            continue;
+        }
+        int def = DefReg(instr);
+        if(def <= 0) continue;
+        if(def == SP) pushed.clear();
+        Sym result;
+        Cond cond;
+        switch(instr.op) {
+            case Op::LI:
+                result = Const(instr.b.value);
+                break;
+            case Op::MOVE:
+                result = regs[instr.b.reg];
+                cond = conds[instr.b.reg];
+                break;
+            case Op::LW:
+                if(ssa.slot_of[i] >= 0) {
+                    if(ssa.value_of[i] >= 0) result = syms[ssa.value_of[i]];
+                }
+                else if(instr.b.value == 0 && instr.b.reg != SP && instr.b.reg != FP) {
+                    // the length word of an array
+                    Sym pointer = regs[instr.b.reg];
+                    if(pointer.base == Sym::VALUE && pointer.offset == 0) {
+                        int offset = ssa.offsets[ssa.values[pointer.id].slot];
+                        auto known = list.array_lengths.find(offset);
+                        result = known != list.array_lengths.end() ? Const(known->second) : Sym{Sym::LEN, pointer.id, 0};
+                    }
+                }
+                break;
+            case Op::ADDI:
+                result = Plus(regs[instr.b.reg], instr.c.value);
+                break;
+            case Op::ADD:
+            case Op::SUB: {
+                Sym l = regs[instr.b.reg], r = sym(instr.c);
+                int sign = instr.op == Op::ADD ? 1 : -1;
+                if(r.base == Sym::CONST) result = Plus(l, sign * r.offset);
+                else if(l.base == Sym::CONST && instr.op == Op::ADD) result = Plus(r, l.offset);
+                break;
+            }
+            case Op::SEQ:
+                // !c of a comparison c
+                if(conds[instr.b.reg].rel != Op::COMMENT && instr.c.kind == Operand::REG && instr.c.reg == ZERO) {
+                    cond = {Negate(conds[instr.b.reg].rel), conds[instr.b.reg].l, conds[instr.b.reg].r};
+                    break;
+                }
+                [[fallthrough]];
+            case Op::SNE: case Op::SLT: case Op::SLE: case Op::SGT: case Op::SGE:
+                cond = {instr.op, regs[instr.b.reg], sym(instr.c)};
+                break;
+            default:
+                break;
+        }
+        regs[def] = result;
+        conds[def] = cond;
+    }
+    if(block.begin < block.end) exit_conds[b] = BranchCond(code[block.end - 1], regs, conds);
+    facts_end[b] = facts;
+}
+
+int RangeAnalysis::DefBlock(int v) const {
+    const SsaValue& value = ssa.values[v];
+    if(value.def >= 0) return cfg.block_of[value.def];
+    if(value.phi >= 0) return ssa.phis[value.phi].block;
+    return 0;
+}
+
+// the value is the same on every iteration of the loop with this header
+bool RangeAnalysis::Invariant(Sym sym, int header) const {
+    if(sym.base == Sym::CONST) return true;
+    if(sym.base == Sym::NONE) return false;
+    int def = DefBlock(sym.id);
+    return def != header && cfg.Dominates(def, header);
+}
+
+bool RangeAnalysis::Less(Sym a, Sym b, const std::vector<Fact>& facts, int depth) const {
+    if(a.base == Sym::NONE || b.base == Sym::NONE) return false;
+    if(a.SameBase(b)) return a.offset < b.offset;
+    if(a.base == Sym::CONST && b.base == Sym::LEN) return a.offset < b.offset;    // lengths are never negative
+    for(const Fact& f : facts) {
+        // a = f.a + da and b = f.b + db, so f.a < f.b gives a < b when da <= db
+        if(f.a.SameBase(a) && f.b.SameBase(b) && a.offset - f.a.offset <= b.offset - f.b.offset) return true;
+    }
+    if(depth >= MAX_DEPTH) return false;
+
+    // induction over a phi node: it holds on entry to the loop and every iteration keeps it
+    bool upper = a.base == Sym::VALUE && ssa.values[a.id].phi >= 0;
+    bool lower = !upper && b.base == Sym::VALUE && ssa.values[b.id].phi >= 0;
+    if(!upper && !lower) return false;
+    const Phi& phi = ssa.phis[ssa.values[upper ? a.id : b.id].phi];
+    if(!Invariant(upper ? b : a, phi.block)) return false;
+    const std::vector<int>& preds = cfg.blocks[phi.block].preds;
+    for(int k = 0; k < (int)phi.args.size(); k++) {
+        if(phi.args[k] < 0) continue;
+        Sym arg = syms[phi.args[k]];
+        if(upper) {
+            if(arg.base == Sym::VALUE && arg.id == phi.value && arg.offset <= 0) continue;
+            if(!Less(Plus(arg, a.offset), b, facts_end[preds[k]], depth + 1)) return false;
+        }
+        else {
+            if(arg.base == Sym::VALUE && arg.id == phi.value && arg.offset >= 0) continue;
+            if(!Less(a, Plus(arg, b.offset), facts_end[preds[k]], depth + 1)) return false;
+        }
+    }
+    return true;
+}
+
+bool RangeAnalysis::InRange(const Check& check) const {
+    return Less(Const(-1), check.index, check.facts) && Less(check.index, check.length, check.facts);
+}
+
+// the SSA value of a slot at the end of a block
+int RangeAnalysis::Reaching(int block, int slot) const {
+    for(int b = block; b >= 0; b = cfg.blocks[b].idom) {
+        for(int i = cfg.blocks[b].end - 1; i >= cfg.blocks[b].begin; i--) {
+            if(ssa.slot_of[i] == slot && list.code[i].op == Op::SW) return ssa.value_of[i];
+        }
+        for(const Phi& phi : ssa.phis) {
+            if(phi.block == b && phi.slot == slot) return phi.value;
+        }
+        if(b == 0) break;
+    }
+    return slot;    // the value on entry
+}
+
+/*
+    Versioning of one innermost loop. The tests need the start of the index and
+    the bounds in registers before the loop, so they must be constants or the
+    values that the slots hold when the loop is entered.
+*/
+class Versioner {
+    public:
+        Versioner(InstrList& list, const RangeAnalysis& range, const Loop& loop)
+        : list(list), range(range), cfg(range.cfg), loop(loop) {}
+        void Run();
+    private:
+        InstrList& list;
+        const RangeAnalysis& range;
+        const Cfg& cfg;
+        const Loop& loop;
+        int entry = -1;                                 // the block falling into the header
+        std::map<int, long> starts;                     // index phi -> lowest value it may start at
+        std::map<std::pair<int, int>, long> bounds;     // (bound, length) -> adjust, tested as bound + adjust <= length
+        std::vector<Sym> bases;                         // the bases the keys of bounds refer to
+
+        bool Covers(const Check& check);
+        bool Available(Sym sym) const;
+        int Base(Sym sym);
+        void Load(Sym sym, Register reg, std::vector<Instruction>& out) const;
+};
+
+// the value is in its slot when the loop is entered
+bool Versioner::Available(Sym sym) const {
+    if(sym.base == Sym::CONST) return true;
+    if(sym.base == Sym::NONE || !range.Invariant(sym, loop.header)) return false;
+    return range.Reaching(entry, range.ssa.values[sym.id].slot) == sym.id;
+}
+
+// the base of a sym without its constant, constants all have the base 0
+int Versioner::Base(Sym sym) {
+    sym.offset = 0;
+    for(int k = 0; k < (int)bases.size(); k++) {
+        if(bases[k].SameBase(sym)) return k;
+    }
+    bases.push_back(sym);
+    return bases.size() - 1;
+}
+
+void Versioner::Load(Sym sym, Register reg, std::vector<Instruction>& out) const {
+    int offset = range.ssa.offsets[range.ssa.values[sym.id].slot];
+    out.push_back(Instruction(Op::LW, reg, Mem(offset, FP)));
+    if(sym.base == Sym::LEN) out.push_back(Instruction(Op::LW, reg, Mem(0, reg), Operand(), "get the length of the array"));
+}
+
+// whether tests before the loop can make the check unnecessary, and if so add them
+bool Versioner::Covers(const Check& check) {
+    // the index must count up from where it starts
+    Sym index = check.index;
+    if(index.base != Sym::VALUE || range.ssa.values[index.id].phi < 0) return false;
+    const Phi& phi = range.ssa.phis[range.ssa.values[index.id].phi];
+    if(phi.block != loop.header) return false;
+    const std::vector<int>& preds = cfg.blocks[loop.header].preds;
+    for(int k = 0; k < (int)preds.size(); k++) {
+        if(preds[k] == entry || phi.args[k] < 0) continue;
+        Sym arg = range.syms[phi.args[k]];
+        if(!(arg.base == Sym::VALUE && arg.id == phi.value && arg.offset >= 0)) return false;
+    }
+    if(std::abs(index.offset) >= MAX_ADJUST) return false;
+    bool low = range.Less(Const(-1), index, check.facts);
+
+    // index = x + c and x + a < bound + b, so index < length + l when bound + (b - a + c - l) <= length
+    bool high = range.Less(index, check.length, check.facts);
+    Sym length = check.length;
+    Sym bound;
+    long adjust = 0;
+    if(!high) {
+        if(length.base == Sym::VALUE || !Available(length)) return false;
+        for(const Fact& f : check.facts) {
+            if(!f.a.SameBase(index) || !Available(f.b)) continue;
+            adjust = f.b.offset - f.a.offset + index.offset - length.offset;
+            if(f.b.base == Sym::CONST && length.base == Sym::CONST && adjust > 0) continue;   // always out of range
+            if(std::abs(adjust) < MAX_ADJUST) {
+                bound = f.b;
+                break;
+            }
+        }
+        if(bound.base == Sym::NONE) return false;
+    }
+
+    if(!low) {
+        auto found = starts.find(phi.value);
+        starts[phi.value] = found == starts.end() ? -index.offset : std::max(found->second, -index.offset);
+    }
+    if(!high && !(bound.base == Sym::CONST && length.base == Sym::CONST)) {
+        auto key = std::make_pair(Base(bound), Base(length));
+        auto found = bounds.find(key);
+        bounds[key] = found == bounds.end() ? adjust : std::max(found->second, adjust);
+    }
+    return true;
+}
+
+void Versioner::Run() {
+    std::vector<Instruction>& code = list.code;
+    if(!cfg.HasPreheader(loop, code)) return;
+    entry = loop.header - 1;
+    // the loop must be one piece of the list that ends with the jump back to the header
+    int begin = cfg.blocks[loop.header].begin, end = begin;
+    for(int b : loop.blocks) end = std::max(end, cfg.blocks[b].end);
+    if(end - begin > MAX_VERSIONED) return;
+    for(int i = begin; i < end; i++) {
+        if(!cfg.InLoop(cfg.block_of[i], &loop - cfg.loops.data())) return;
+    }
+    if(code[end - 1].op != Op::J || BranchTarget(code[end - 1], cfg.labels) != begin) return;
+
+    std::vector<int> covered;
+    for(const Check& check : range.checks) {
+        if(check.instr < begin || check.instr >= end || code[check.instr].op != Op::BGEU) continue;
+        if(Covers(check)) covered.push_back(check.instr);
+    }
+    if(covered.empty()) return;
+
+    // the tests jump to the original loop, which keeps its checks
+    Operand checked = code[begin].a;
+    std::vector<Instruction> version = {Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### Loop Versioning ###")};
+    for(auto [phi, lowest] : starts) {
+        Load({Sym::VALUE, phi, 0}, T0, version);    // the slot holds the value the phi starts with
+        version.push_back(Instruction(Op::BLT, T0, Imm(lowest), checked, "the index could start out of bounds"));
+    }
+    for(auto [key, adjust] : bounds) {
+        Sym bound = bases[key.first], length = bases[key.second];
+        if(bound.base == Sym::CONST) version.push_back(Instruction(Op::LI, T0, Imm(adjust)));
+        else Load(bound, T0, version);
+        if(length.base == Sym::CONST) {
+            long limit = bound.base == Sym::CONST ? 0 : -adjust;
+            version.push_back(Instruction(Op::BGT, T0, Imm(limit), checked, "the index could go past the end of the array"));
+            continue;
+        }
+        Load(length, T1, version);
+        if(bound.base != Sym::CONST && adjust != 0) version.push_back(Instruction(Op::ADDI, T1, T1, Imm(-adjust)));
+        version.push_back(Instruction(Op::BGT, T0, T1, checked, "the index could go past the end of the array"));
+    }
+
+    // the copy without the checks has labels of its own
+    std::unordered_map<int, int> renamed;
+    for(int i = begin; i < end; i++) {
+        if(code[i].op == Op::LABEL) renamed[code[i].a.value] = Lbl(LabelName(code[i].a.value) + "_unchecked").value;
+    }
+    for(int i = begin; i < end; i++) {
+        if(std::find(covered.begin(), covered.end(), i) != covered.end()) continue;
+        Instruction instr = code[i];
+        for(Operand* o : {&instr.a, &instr.b, &instr.c}) {
+            if(o->kind == Operand::LABEL && renamed.count(o->value)) o->value = renamed[o->value];
+        }
+        version.push_back(instr);
+    }
+    code.insert(code.begin() + begin, version.begin(), version.end());
+}
+
+void RemoveBoundsChecks(InstrList& list) {
+    RangeAnalysis range(list);
+    if(range.checks.empty()) return;
+    for(const Check& check : range.checks) {
+        if(range.InRange(check)) list.code[check.instr] = Instruction(Op::COMMENT);
+    }
+    // version the innermost loops from the end of the list, so the indices of the others stay valid
+    const Cfg& cfg = range.cfg;
+    std::vector<const Loop*> innermost;
+    for(const Loop& loop : cfg.loops) {
+        bool inner = true;
+        for(const Loop& other : cfg.loops) {
+            if(other.parent == &loop - cfg.loops.data()) inner = false;
+        }
+        if(inner) innermost.push_back(&loop);
+    }
+    std::sort(innermost.begin(), innermost.end(),
+        [&](const Loop* a, const Loop* b) { return cfg.blocks[a->header].begin > cfg.blocks[b->header].begin; });
+    for(const Loop* loop : innermost) Versioner(list, range, *loop).Run();
+    list.code.erase(std::remove_if(list.code.begin(), list.code.end(),
+        [](const Instruction& instr) { return instr.op == Op::COMMENT && instr.comment.empty(); }), list.code.end());
+}
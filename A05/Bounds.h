@@ -0,0 +1,34 @@
+/*
+Bounds.h
+Corbin Weiss
+17 October 2026
+
+Removal of array bounds checks that can never fail
+*/
+
+/*
+*** Outline of Approach ***
+Every array access checks 0 <= index < length with one unsigned bgeu. The
+checks are removed where the index is known to be in range:
+  - values are tracked symbolically as a base plus a constant, where the base is
+    an SSA value of a slot (see Ssa.h), the length of the array in an SSA value
+    or nothing for a constant. A local array declared with a size has a constant
+    length.
+  - the condition of a branch is a fact about these values on each of its
+    edges, and so is a bounds check on the path where it does not fail. The
+    facts hold in all blocks dominated by the edge or the check.
+  - index < length is proven from a fact with the same bases, or by induction
+    over a phi node of a loop: it holds when it holds for the value entering
+    the loop and the loop only makes the value smaller. 0 <= index is proven
+    the same way for values the loop only makes larger.
+When a check in an innermost while loop can not be proven, but its index is a
+value the loop only counts up from its start, and the condition of the loop
+bounds it from above, the loop is versioned: a test before the loop compares
+the start and the bound of the index with the length once, and jumps to the
+original loop with its checks if they might fail. Otherwise it falls into a
+copy of the loop without those checks.
+*/
+#pragma once
+#include "Instruction.h"
+
+void RemoveBoundsChecks(InstrList& list);
@@ -0,0 +1,223 @@
+/*
+Cfg.cpp
+Corbin Weiss
+17 October 2026
+
+Implement basic block construction, dominators and loop nesting
+*/
+
+#include "Cfg.h"
+#include <algorithm>
+
+int BranchTarget(const Instruction& instr, const std::unordered_map<int, int>& labels) {
+    const Operand* l = nullptr;
+    if(instr.op == Op::J) l = &instr.a;
+    else if(IsBranch(instr.op)) l = instr.c.kind == Operand::LABEL ? &instr.c : &instr.b;
+    if(!l) return -1;
+    auto found = labels.find(l->value);
+    return found == labels.end() ? -1 : found->second;
+}
+
+// instructions after which control does not simply continue with the next one
+static bool EndsBlock(const Instruction& instr) {
+    return IsBranch(instr.op) || instr.op == Op::J || instr.op == Op::JR;
+}
+
+Cfg::Cfg(const InstrList& list) {
+    BuildBlocks(list.code);
+    BuildDominators();
+    BuildLoops();
+}
+
+void Cfg::BuildBlocks(const std::vector<Instruction>& code) {
+    int n = code.size();
+    block_of.assign(n, -1);
+    for(int i = 0; i < n; i++) {
+        if(code[i].op == Op::LABEL) labels[code[i].a.value] = i;
+    }
+    // find the first instruction of every block
+    std::vector<bool> leader(n + 1, false);
+    leader[0] = true;
+    for(int i = 0; i < n; i++) {
+        if(code[i].op == Op::LABEL) leader[i] = true;
+        if(EndsBlock(code[i])) leader[i+1] = true;
+    }
+    for(int i = 0; i < n; i++) {
+        if(leader[i]) blocks.push_back(BasicBlock(i, i));
+        blocks.back().end = i + 1;
+        block_of[i] = blocks.size() - 1;
+    }
+    if(blocks.empty()) blocks.push_back(BasicBlock(0, 0));
+
+    for(int b = 0; b < (int)blocks.size(); b++) {
+        BasicBlock& block = blocks[b];
+        if(block.begin == block.end) continue;
+        const Instruction& last = code[block.end - 1];
+        int target = BranchTarget(last, labels);
+        if(target >= 0) block.succs.push_back(block_of[target]);
+        bool falls_through = last.op != Op::J && last.op != Op::JR;
+        if(falls_through && b + 1 < (int)blocks.size()) {
+            if(std::find(block.succs.begin(), block.succs.end(), b + 1) == block.succs.end()) block.succs.push_back(b + 1);
+        }
+        for(int s : block.succs) blocks[s].preds.push_back(b);
+    }
+}
+
+void Cfg::BuildDominators() {
+    // depth first search from the entry for the postorder
+    int nblocks = blocks.size();
+    std::vector<int> postorder;
+    std::vector<bool> visited(nblocks, false);
+    std::vector<std::pair<int, int>> stack = {{0, 0}};  // block, next successor to visit
+    visited[0] = true;
+    while(!stack.empty()) {
+        auto& [b, next] = stack.back();
+        if(next < (int)blocks[b].succs.size()) {
+            int s = blocks[b].succs[next++];
+            if(!visited[s]) {
+                visited[s] = true;
+                stack.push_back({s, 0});
+            }
+        }
+        else {
+            postorder.push_back(b);
+            stack.pop_back();
+        }
+    }
+    order.assign(postorder.rbegin(), postorder.rend());
+    rpo_index.assign(nblocks, -1);
+    for(int i = 0; i < (int)order.size(); i++) rpo_index[order[i]] = i;
+
+    // iterate to the fixed point: idom(b) is the common dominator of its processed predecessors
+    std::vector<int> doms(nblocks, -1);
+    doms[0] = 0;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(int b : order) {
+            if(b == 0) continue;
+            int idom = -1;
+            for(int p : blocks[b].preds) {
+                if(doms[p] < 0) continue;
+                idom = idom < 0 ? p : Intersect(p, idom, doms);
+            }
+            if(idom != doms[b]) {
+                doms[b] = idom;
+                changed = true;
+            }
+        }
+    }
+    for(int b = 1; b < nblocks; b++) blocks[b].idom = doms[b];
+}
+
+// the nearest common dominator of a and b in the partially computed tree
+int Cfg::Intersect(int a, int b, const std::vector<int>& doms) const {
+    while(a != b) {
+        while(rpo_index[a] > rpo_index[b]) a = doms[a];
+        while(rpo_index[b] > rpo_index[a]) b = doms[b];
+    }
+    return a;
+}
+
+bool Cfg::Dominates(int a, int b) const {
+    if(!Reachable(a) || !Reachable(b)) return false;
+    while(b != a && b > 0) b = blocks[b].idom;
+    return b == a;
+}
+
+void Cfg::BuildLoops() {
+    // natural loops of the back edges, one loop per header
+    std::unordered_map<int, int> loop_of_header;
+    for(int b : order) {
+        for(int h : blocks[b].succs) {
+            if(!Dominates(h, b)) continue;
+            auto found = loop_of_header.find(h);
+            if(found == loop_of_header.end()) {
+                found = loop_of_header.emplace(h, loops.size()).first;
+                loops.push_back(Loop(h));
+            }
+            loops[found->second].latches.push_back(b);
+        }
+    }
+    for(Loop& loop : loops) {
+        std::vector<bool> in_loop(blocks.size(), false);
+        in_loop[loop.header] = true;
+        std::vector<int> work = loop.latches;
+        while(!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            if(in_loop[b]) continue;
+            in_loop[b] = true;
+            for(int p : blocks[b].preds) {
+                if(Reachable(p)) work.push_back(p);
+            }
+        }
+        for(int b : order) {
+            if(in_loop[b]) loop.blocks.push_back(b);
+        }
+    }
+
+    // an outer loop has more blocks than the loops it contains
+    std::stable_sort(loops.begin(), loops.end(),
+        [](const Loop& a, const Loop& b) { return a.blocks.size() > b.blocks.size(); });
+    for(int l = 0; l < (int)loops.size(); l++) {
+        for(int b : loops[l].blocks) {
+            // the loops are in order of size, so the last one to claim a block is the innermost
+            int outer = blocks[b].loop;
+            if(b == loops[l].header && outer >= 0) {
+                loops[l].parent = outer;
+                loops[l].depth = loops[outer].depth + 1;
+            }
+            blocks[b].loop = l;
+        }
+    }
+}
+
+int Cfg::Depth(int block) const {
+    return blocks[block].loop < 0 ? 0 : loops[blocks[block].loop].depth;
+}
+
+bool Cfg::InLoop(int block, int loop) const {
+    for(int l = blocks[block].loop; l >= 0; l = loops[l].parent) {
+        if(l == loop) return true;
+    }
+    return false;
+}
+
+std::vector<std::vector<int>> Cfg::DominatorTree() const {
+    std::vector<std::vector<int>> children(blocks.size());
+    for(int b : order) {
+        if(b != 0) children[blocks[b].idom].push_back(b);
+    }
+    return children;
+}
+
+std::vector<std::vector<int>> Cfg::DominanceFrontiers() const {
+    std::vector<std::vector<int>> frontiers(blocks.size());
+    for(int b : order) {
+        if(blocks[b].preds.size() < 2) continue;
+        for(int p : blocks[b].preds) {
+            if(!Reachable(p)) continue;
+            // walk up from each predecessor to the immediate dominator of the join
+            for(int runner = p; runner != blocks[b].idom; runner = blocks[runner].idom) {
+                std::vector<int>& df = frontiers[runner];
+                if(std::find(df.begin(), df.end(), b) == df.end()) df.push_back(b);
+                if(runner == 0) break;
+            }
+        }
+    }
+    return frontiers;
+}
+
+bool Cfg::HasPreheader(const Loop& loop, const std::vector<Instruction>& code) const {
+    const BasicBlock& header = blocks[loop.header];
+    if(header.begin == header.end || code[header.begin].op != Op::LABEL) return false;
+    bool entered = false;
+    for(int p : header.preds) {
+        if(InLoop(p, &loop - loops.data())) continue;
+        const BasicBlock& pred = blocks[p];
+        if(p != loop.header - 1 || BranchTarget(code[pred.end - 1], labels) == header.begin) return false;
+        entered = true;
+    }
+    return entered;
+}
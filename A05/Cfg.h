@@ -0,0 +1,75 @@
+/*
+Cfg.h
+Corbin Weiss
+17 October 2026
+
+Control flow graph, dominator tree and loop nesting of a function's instruction list
+*/
+
+/*
+*** Outline of Approach ***
+The code generator lowers the body of every function into an InstrList, so the
+control flow graph is built from that list rather than from the AST:
+  - a basic block starts at a label, at the first instruction and after every
+    branch or jump, and ends before the next one
+  - a branch or j to a label inside the function is an edge, a fall through is
+    an edge, jr ends the function. Branches to the runtime error handlers leave
+    the function and are not edges.
+Dominators are computed with the iterative algorithm of Cooper, Harvey and
+Kennedy over the blocks in reverse postorder. An edge whose target dominates its
+source is a back edge. The natural loop of a header is the set of blocks that
+reach one of its back edges without going through the header, and loops nest by
+containment.
+The graph refers to the instructions by index, so it must be rebuilt after
+instructions are inserted or removed.
+*/
+#pragma once
+#include "Instruction.h"
+#include <unordered_map>
+
+struct BasicBlock {
+    int begin, end;             // the instructions [begin, end) of the list
+    std::vector<int> succs;
+    std::vector<int> preds;
+    int idom = -1;              // immediate dominator, -1 for the entry and unreachable blocks
+    int loop = -1;              // innermost loop containing the block, -1 if none
+    BasicBlock(int begin, int end) : begin(begin), end(end) {}
+};
+
+struct Loop {
+    int header;
+    int parent = -1;            // the enclosing loop, -1 for an outermost loop
+    int depth = 1;              // 1 for an outermost loop
+    std::vector<int> blocks;    // all blocks of the loop, including inner loops
+    std::vector<int> latches;   // sources of the back edges to the header
+    Loop(int header) : header(header) {}
+};
+
+class Cfg {
+    private:
+        std::vector<int> rpo_index;     // position of each block in order, -1 if unreachable
+        int Intersect(int a, int b, const std::vector<int>& doms) const;
+        void BuildBlocks(const std::vector<Instruction>& code);
+        void BuildDominators();
+        void BuildLoops();
+    public:
+        std::vector<BasicBlock> blocks;
+        std::vector<Loop> loops;            // outer loops come before the loops they contain
+        std::vector<int> block_of;          // the block of each instruction
+        std::vector<int> order;             // reachable blocks in reverse postorder, the entry first
+        std::unordered_map<int, int> labels;    // label id -> index of the instruction defining it
+
+        explicit Cfg(const InstrList& list);
+        bool Reachable(int block) const { return rpo_index[block] >= 0; }
+        bool Dominates(int a, int b) const;             // every path from the entry to b goes through a
+        int Depth(int block) const;                     // loop nesting depth of a block
+        bool InLoop(int block, int loop) const;         // the block is part of the loop or one of its inner loops
+        std::vector<std::vector<int>> DominatorTree() const;       // children of each block
+        std::vector<std::vector<int>> DominanceFrontiers() const;
+        // the loop is only entered by falling through into the label of its header,
+        // so code inserted before that label runs once before the loop
+        bool HasPreheader(const Loop& loop, const std::vector<Instruction>& code) const;
+};
+
+// the instruction a branch or j in the function goes to, or -1
+int BranchTarget(const Instruction& instr, const std::unordered_map<int, int>& labels);
@@ -0,0 +1,189 @@
+/*
+Emitter.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the buffered assembly Emitter
+*/
+
+#include "Emitter.h"
+#include <cstring>
+#include <charconv>
+
+Emitter::Emitter(FILE* fdout, bool compact)
+: fdout(fdout), compact(compact)
+{
+    buffer.reserve(FLUSH_THRESHOLD);
+}
+
+Emitter::~Emitter() {
+    flush();
+}
+
+/*
+    In compact mode strip the comment, the padding before it and any
+    leading blank lines from the line starting at buffer[start].
+    Lines that are left empty are removed completely.
+*/
+void Emitter::endLine(std::size_t start) {
+    if(compact) {
+        // a '#' inside a string or character literal does not start a comment
+        char quote = 0;
+        std::size_t end = buffer.size();
+        for(std::size_t i = start; i < buffer.size(); i++) {
+            char c = buffer[i];
+            if(quote) {
+                if(c == quote) quote = 0;
+            }
+            else if(c == '"' || c == '\'') {
+                quote = c;
+            }
+            else if(c == '#') {
+                end = i;
+                break;
+            }
+        }
+        while(end > start && (buffer[end-1] == ' ' || buffer[end-1] == '\t')) {
+            end--;
+        }
+        std::size_t begin = start;
+        while(begin < end && buffer[begin] == '\n') {
+            begin++;
+        }
+        bool empty = true;
+        for(std::size_t i = begin; i < end; i++) {
+            if(buffer[i] != ' ' && buffer[i] != '\t') {
+                empty = false;
+                break;
+            }
+        }
+        if(empty) {
+            buffer.resize(start);
+            return;
+        }
+        buffer.resize(end);
+        if(begin > start) buffer.erase(start, begin - start);
+    }
+    buffer += '\n';
+}
+
+void Emitter::line(const char* text) {
+    std::size_t start = buffer.size();
+    buffer.append(text);
+    endLine(start);
+}
+
+void Emitter::write(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vwrite(fmt, args);
+    va_end(args);
+}
+
+void Emitter::vwrite(const char* fmt, va_list args) {
+    // lines without any arguments don't need to go through the formatter
+    if(!strchr(fmt, '%')) {
+        line(fmt);
+        return;
+    }
+    std::size_t start = buffer.size();
+    char local[256];
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(local, sizeof(local), fmt, copy);
+    va_end(copy);
+    if(len < 0) return;
+    if(static_cast<std::size_t>(len) < sizeof(local)) {
+        buffer.append(local, len);
+    }
+    else {  // too long for the local buffer, format straight into the output buffer
+        buffer.resize(start + len + 1);
+        vsnprintf(&buffer[start], len + 1, fmt, args);
+        buffer.resize(start + len);
+    }
+    endLine(start);
+}
+
+void Emitter::block(const char* text) {
+    if(!compact) {
+        buffer.append(text);
+        return;
+    }
+    // strip every line of the block separately
+    const char* p = text;
+    while(*p) {
+        const char* nl = strchr(p, '\n');
+        std::size_t n = nl ? nl - p : strlen(p);
+        std::size_t start = buffer.size();
+        buffer.append(p, n);
+        endLine(start);
+        p += n;
+        if(nl) p++;
+    }
+}
+
+void Emitter::operand(const Operand& o) {
+    char num[16];
+    char* end;
+    switch(o.kind) {
+        case Operand::REG:
+            buffer.append(RegName(o.reg));
+            break;
+        case Operand::IMM:
+            end = std::to_chars(num, num + sizeof(num), o.value).ptr;
+            buffer.append(num, end - num);
+            break;
+        case Operand::LABEL:
+            buffer.append(LabelName(o.value));
+            break;
+        case Operand::MEM:
+            end = std::to_chars(num, num + sizeof(num), o.value).ptr;
+            buffer.append(num, end - num).append("(").append(RegName(o.reg)).append(")");
+            break;
+        case Operand::NONE:
+            break;
+    }
+}
+
+void Emitter::emit(const Instruction& instr) {
+    if(instr.op == Op::COMMENT) {
+        if(!compact) buffer.append("\t").append(instr.comment).append("\n");
+        return;
+    }
+    if(instr.op == Op::LABEL) {
+        buffer.append(LabelName(instr.a.value)).append(":");
+    }
+    else {
+        buffer.append("\t").append(OpName(instr.op));
+        const Operand* ops[] = {&instr.a, &instr.b, &instr.c};
+        for(int i = 0; i < 3 && ops[i]->kind != Operand::NONE; i++) {
+            buffer.append(i == 0 ? " " : ", ");
+            operand(*ops[i]);
+        }
+    }
+    if(!compact && !instr.comment.empty()) {
+        buffer.append("\t\t# ").append(instr.comment);
+    }
+    buffer += '\n';
+}
+
+void Emitter::emit(const InstrList& list) {
+    if(!compact) buffer += '\n';
+    for(const Instruction& instr : list.code) {
+        emit(instr);
+    }
+}
+
+void Emitter::MaybeFlush() {
+    if(buffer.size() >= FLUSH_THRESHOLD) {
+        flush();
+    }
+}
+
+void Emitter::flush() {
+    if(!buffer.empty() && fdout) {
+        fwrite(buffer.data(), 1, buffer.size(), fdout);
+        fflush(fdout);
+    }
+    buffer.clear();
+}
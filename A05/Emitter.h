@@ -0,0 +1,46 @@
+/*
+Emitter.h
+Corbin Weiss
+17 October 2026
+
+Buffer the generated MIPS code in memory and write it to a.s in bulk
+*/
+
+/*
+*** Outline of Approach ***
+Every line of assembly is appended to a growable in-memory buffer instead of
+going straight to the output file. Function code arrives as a finished InstrList
+and is printed from its operands directly without going through printf.
+The buffer is flushed with a single fwrite once it grows past FLUSH_THRESHOLD
+(checked at function boundaries) and once more at the end of the program.
+In compact mode the '# ...' comments, comment-only lines and padding are
+dropped as the lines are appended, which makes a.s smaller and faster to assemble.
+*/
+#pragma once
+#include <cstdio>
+#include <cstdarg>
+#include <string>
+#include "Instruction.h"
+
+class Emitter {
+    private:
+        FILE* fdout;
+        std::string buffer;     // assembly that has not been written to fdout yet
+        bool compact;           // drop comments and padding from the output
+        void endLine(std::size_t start);   // finish the line that begins at buffer[start]
+        void operand(const Operand& o);
+    public:
+        static const std::size_t FLUSH_THRESHOLD = 1 << 16;
+
+        Emitter(FILE* fdout, bool compact = false);
+        ~Emitter();
+        bool IsCompact() { return compact; }
+        void line(const char* text);                // append one line verbatim
+        void write(const char* fmt, ...);           // append one printf-formatted line
+        void vwrite(const char* fmt, va_list args);
+        void block(const char* text);               // append a multi-line block such as the malloc runtime
+        void emit(const Instruction& instr);        // print one instruction
+        void emit(const InstrList& list);           // print the code of a whole function
+        void MaybeFlush();                          // flush if the buffer has grown past FLUSH_THRESHOLD
+        void flush();                               // write the whole buffer to fdout
+};
@@ -0,0 +1,175 @@
+/*
+Frame.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the prologue and epilogue of leaf, frameless and shrink-wrapped functions
+*/
+
+#include "Frame.h"
+#include "Cfg.h"
+#include "Tail.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+// restore the registers and leave the frame, without the final jump
+static std::vector<Instruction> Epilogue(const std::vector<SavedReg>& saved, bool restore_ra) {
+    std::vector<Instruction> code;
+    for(SavedReg reg : saved) {
+        code.push_back(Instruction(Op::LW, reg.reg, Mem(reg.offset, FP), Operand(), "restore the callee-saved register"));
+    }
+    code.push_back(Instruction(Op::MOVE, SP, FP, Operand(), "clear the stack of local variables"));
+    if(restore_ra) code.push_back(Instruction(Op::LW, RA, Mem(4, FP), Operand(), "fetch the $ra from the stack"));
+    code.push_back(Instruction(Op::LW, FP, Mem(8, FP), Operand(), "reset the $fp to the caller state"));
+    code.push_back(Instruction(Op::ADDI, SP, SP, Imm(8), "reset the stack"));
+    return code;
+}
+
+/*
+    The body only reads its arguments through $fp, before it first moves $sp,
+    and $sp is the same on every path through a block. Fills leave with how far
+    the body has moved $sp where it leaves: at each tail call to another function
+    and at the end, where it falls into the epilogue.
+*/
+static bool Frameless(const InstrList& list, std::unordered_map<int, int>& leave) {
+    const std::vector<Instruction>& code = list.code;
+    bool moved = false;
+    for(int i = list.body; i < (int)code.size(); i++) {
+        const Instruction& instr = code[i];
+        if(UsesReg(instr, FP) || DefReg(instr) == FP) {
+            if(moved || instr.op != Op::LW || instr.b.reg != FP || instr.b.value <= 0 || instr.a.reg == FP) return false;
+        }
+        if(DefReg(instr) == SP || instr.op == Op::LABEL || IsBranch(instr.op) || IsJump(instr.op)) moved = true;
+    }
+
+    Cfg cfg(list);
+    std::vector<int> entry(cfg.blocks.size(), INT_MIN);     // $sp relative to the start of the body
+    entry[0] = 0;
+    Operand tail_return = TailReturnLabel(list.name);
+    leave[code.size()] = 0;
+    int last = code.empty() ? -1 : cfg.block_of[code.size() - 1];
+    for(int b : cfg.order) {
+        const BasicBlock& block = cfg.blocks[b];
+        int sp = entry[b];
+        for(int i = block.begin; i < block.end; i++) {
+            const Instruction& instr = code[i];
+            if(instr.op == Op::J && instr.a.value == tail_return.value) leave[i] = sp;
+            if(DefReg(instr) != SP) continue;
+            if(instr.op != Op::ADDI || instr.b.reg != SP || instr.c.kind != Operand::IMM) return false;
+            sp += instr.c.value;
+        }
+        for(int succ : block.succs) {
+            if(entry[succ] != INT_MIN && entry[succ] != sp) return false;
+            entry[succ] = sp;
+        }
+        if(b == last && (block.begin == block.end || code[block.end - 1].op != Op::J)) leave[code.size()] = sp;
+    }
+    return true;
+}
+
+/*
+    Save $ra at the start of the block that dominates every call, if that is not
+    the entry block and not in a loop, and restore it on every edge that leaves
+    the blocks it dominates. Returns false if the prologue has to save it.
+*/
+static bool ShrinkWrap(InstrList& list) {
+    std::vector<Instruction>& code = list.code;
+    Cfg cfg(list);
+    int wrap = -1;
+    for(int b : cfg.order) {
+        const BasicBlock& block = cfg.blocks[b];
+        if(std::none_of(code.begin() + block.begin, code.begin() + block.end,
+            [](const Instruction& instr) { return instr.op == Op::JAL; })) continue;
+        if(wrap < 0) wrap = b;
+        while(!cfg.Dominates(wrap, b)) wrap = cfg.blocks[wrap].idom;
+    }
+    if(wrap <= 0 || cfg.Depth(wrap) > 0) return false;
+
+    std::vector<std::pair<int, Instruction>> inserts;   // index -> instruction to insert before it
+    const BasicBlock& first = cfg.blocks[wrap];
+    int save = first.begin < first.end && code[first.begin].op == Op::LABEL ? first.begin + 1 : first.begin;
+    inserts.push_back({save, Instruction(Op::SW, RA, Mem(4, FP), Operand(), "store the return address")});
+    int last = cfg.block_of[code.size() - 1];
+    for(int b : cfg.order) {
+        if(!cfg.Dominates(wrap, b)) continue;
+        const BasicBlock& block = cfg.blocks[b];
+        bool leaves = b == last && (block.begin == block.end || code[block.end - 1].op != Op::J);
+        for(int succ : block.succs) {
+            if(cfg.Dominates(wrap, succ)) continue;
+            if(block.succs.size() != 1) return false;
+            leaves = true;
+        }
+        if(!leaves) continue;
+        int restore = block.end;
+        if(block.begin < block.end && (IsBranch(code[block.end - 1].op) || code[block.end - 1].op == Op::J)) restore--;
+        inserts.push_back({restore, Instruction(Op::LW, RA, Mem(4, FP), Operand(), "fetch the $ra from the stack")});
+    }
+    // back to front, so the indices of the earlier ones stay the same
+    std::stable_sort(inserts.begin(), inserts.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+    for(const auto& [index, instr] : inserts) code.insert(code.begin() + index, instr);
+    return true;
+}
+
+// put a copy of the epilogue for the instruction in place of every tail call that jumps to the epilogue
+template<typename Epilogue>
+static void LeaveToCallees(InstrList& list, Epilogue epilogue) {
+    Operand tail_return = TailReturnLabel(list.name);
+    std::vector<Instruction> expanded;
+    expanded.reserve(list.code.size());
+    for(int i = 0; i < (int)list.code.size(); i++) {
+        const Instruction& instr = list.code[i];
+        if(instr.op != Op::J || instr.a.value != tail_return.value) {
+            expanded.push_back(instr);
+            continue;
+        }
+        Instruction leave(Op::JR, T9);
+        if(!expanded.empty() && expanded.back().op == Op::LA && expanded.back().a.reg == T9) {
+            leave = Instruction(Op::J, expanded.back().b, Operand(), Operand(), "go on to the callee");
+            expanded.pop_back();
+        }
+        std::vector<Instruction> copy = epilogue(i);
+        expanded.insert(expanded.end(), copy.begin(), copy.end());
+        expanded.push_back(leave);
+    }
+    list.code.swap(expanded);
+}
+
+void BuildFrame(InstrList& list, const std::vector<SavedReg>& saved) {
+    std::vector<Instruction>& code = list.code;
+    bool leaf = std::none_of(code.begin(), code.end(), [](const Instruction& instr) { return instr.op == Op::JAL; });
+    std::unordered_map<int, int> leave;
+    if(leaf && saved.empty() && Frameless(list, leave)) {
+        // the arguments are right above $sp, where $fp would have been 8 bytes lower
+        for(int i = list.body; i < (int)code.size(); i++) {
+            if(code[i].op == Op::LW && code[i].b.reg == FP) code[i].b = Mem(code[i].b.value - 8, SP);
+        }
+        auto pop = [&](int i) {
+            std::vector<Instruction> epilogue;
+            if(leave[i] != 0) epilogue.push_back(Instruction(Op::ADDI, SP, SP, Imm(-leave[i]), "pop what is left on the stack"));
+            return epilogue;
+        };
+        std::vector<Instruction> epilogue = pop(code.size());
+        code.insert(code.end(), epilogue.begin(), epilogue.end());
+        code.push_back(Instruction(Op::JR, RA));
+        if(list.tail_return) LeaveToCallees(list, pop);
+        return;
+    }
+
+    bool save_ra = !leaf && (list.tail_return || !ShrinkWrap(list));
+    std::vector<Instruction> epilogue = Epilogue(saved, save_ra);
+    code.insert(code.end(), epilogue.begin(), epilogue.end());
+    code.push_back(Instruction(Op::JR, RA));
+    if(list.tail_return) LeaveToCallees(list, [&](int) { return epilogue; });
+
+    // the register allocator may have added slots, so the size of the frame is only known now
+    std::vector<Instruction> prologue = {Instruction(Op::ADDI, SP, SP, Imm(-8), "make space for $fp and $ra on stack")};
+    if(save_ra) prologue.push_back(Instruction(Op::SW, RA, Mem(4, SP), Operand(), "store the return address"));
+    prologue.push_back(Instruction(Op::SW, FP, Mem(8, SP), Operand(), "store the old frame pointer"));
+    prologue.push_back(Instruction(Op::MOVE, FP, SP, Operand(), "move the frame pointer to the top of the stack"));
+    if(list.frame_words > 0) {
+        prologue.push_back(Instruction(Op::ADDI, SP, SP, Imm(-4 * list.frame_words), "allocate the stack frame"));
+    }
+    code.insert(code.begin() + list.body, prologue.begin(), prologue.end());
+}
@@ -0,0 +1,33 @@
+/*
+Frame.h
+Corbin Weiss
+17 October 2026
+
+Prologue and epilogue of a function, shaped to what the body needs
+*/
+
+/*
+*** Outline of Approach ***
+The code generator leaves the prologue and the epilogue out, and they are only
+added once the body has been optimized and its variables are in registers, when
+it is known what the function really needs from its frame:
+  - a leaf function, one without any jal, never changes $ra, so it neither saves
+    nor restores it. Its word in the frame is still there, so the arguments stay
+    at the same offsets from $fp.
+  - a leaf function that no longer reads or writes a slot and only reads its
+    arguments before it first moves $sp has no frame at all. The arguments are
+    read relative to $sp instead of $fp, and the epilogue is just jr $ra, after
+    popping what the body left on the stack.
+  - when the calls are only on some paths, $ra is saved at the start of the
+    block that dominates all the calls, as long as it is not in a loop. Every
+    edge that leaves the blocks it dominates restores $ra, so the paths without
+    a call never touch it.
+  - every tail call to another function gets its own copy of the epilogue,
+    which ends in a jump to the callee.
+*/
+#pragma once
+#include "Instruction.h"
+#include "RegAlloc.h"
+
+// add the prologue at the body of the function and the epilogue at its end
+void BuildFrame(InstrList& list, const std::vector<SavedReg>& saved);
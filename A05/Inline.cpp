@@ -0,0 +1,225 @@
+/*
+Inline.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the call graph and the substitution of callee bodies at their call sites
+*/
+
+#include "Inline.h"
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+static const int MAX_INLINE_SIZE = 60;      // a body this small is always cheaper than the call
+static const int MAX_SINGLE_SIZE = 400;     // a larger body is still inlined into its only caller
+static const int MAX_FUNCTION_SIZE = 2000;  // callers are not grown past this size
+
+class Inliner {
+    public:
+        explicit Inliner(std::vector<InstrList*>& functions);
+        void Run();
+    private:
+        std::vector<InstrList*>& functions;
+        std::unordered_map<int, int> index;         // label id of a function -> its index
+        std::vector<std::set<int>> callees;
+        std::vector<int> calls;                     // call sites of each function
+        std::vector<bool> recursive;
+        int copies = 0;                             // the number of bodies inlined, for the labels
+
+        int Callee(const Instruction& instr) const;
+        int Size(int f) const;
+        bool Reaches(int from, int to, std::vector<bool>& seen) const;
+        bool Inlinable(int g) const;
+        bool Worth(int g, int caller_size) const;
+        void Expand(int g, InstrList& caller, std::vector<Instruction>& out);
+        void InlineInto(int f);
+        void PostOrder(int f, std::vector<bool>& seen, std::vector<int>& order) const;
+};
+
+Inliner::Inliner(std::vector<InstrList*>& functions)
+: functions(functions), callees(functions.size()), calls(functions.size(), 0), recursive(functions.size(), false) {
+    for(int f = 0; f < (int)functions.size(); f++) index[Lbl("__" + functions[f]->name).value] = f;
+    for(int f = 0; f < (int)functions.size(); f++) {
+        for(const Instruction& instr : functions[f]->code) {
+            int g = Callee(instr);
+            if(g < 0) continue;
+            callees[f].insert(g);
+            calls[g]++;
+        }
+    }
+    for(int f = 0; f < (int)functions.size(); f++) {
+        std::vector<bool> seen(functions.size(), false);
+        recursive[f] = Reaches(f, f, seen);
+    }
+}
+
+// the function a jal goes to, or -1 for the runtime
+int Inliner::Callee(const Instruction& instr) const {
+    if(instr.op != Op::JAL) return -1;
+    auto found = index.find(instr.a.value);
+    return found == index.end() ? -1 : found->second;
+}
+
+// the instructions of the body, without comments and labels
+int Inliner::Size(int f) const {
+    const InstrList& list = *functions[f];
+    int size = 0;
+    for(int i = list.body; i < (int)list.code.size(); i++) {
+        if(list.code[i].op != Op::COMMENT && list.code[i].op != Op::LABEL) size++;
+    }
+    return size;
+}
+
+bool Inliner::Reaches(int from, int to, std::vector<bool>& seen) const {
+    for(int g : callees[from]) {
+        if(g == to) return true;
+        if(seen[g]) continue;
+        seen[g] = true;
+        if(Reaches(g, to, seen)) return true;
+    }
+    return false;
+}
+
+// the address of an array in the frame of the function
+static bool IsStackArray(const InstrList& list, const Instruction& instr) {
+    return instr.op == Op::ADDIU && instr.b.reg == FP && list.stack_arrays.count(instr.c.value);
+}
+
+// the parameters are only read before the body first moves $sp, and $fp is only a base of slots and arrays
+bool Inliner::Inlinable(int g) const {
+    const InstrList& list = *functions[g];
+    bool moved = false;
+    for(int i = list.body; i < (int)list.code.size(); i++) {
+        const Instruction& instr = list.code[i];
+        bool memory = instr.op == Op::LW || instr.op == Op::SW;
+        if(memory && instr.b.reg == FP && instr.b.value > 0 && moved) return false;
+        if(DefReg(instr) == SP || instr.op == Op::LABEL || IsBranch(instr.op) || IsJump(instr.op)) moved = true;
+        if(IsStackArray(list, instr)) continue;
+        if(UsesReg(instr, FP) && !(memory && instr.b.reg == FP && instr.a.reg != FP)) return false;
+        if(DefReg(instr) == FP) return false;
+    }
+    return true;
+}
+
+// whether to inline g into a caller of the given size
+bool Inliner::Worth(int g, int caller_size) const {
+    if(recursive[g] || !Inlinable(g)) return false;
+    int size = Size(g);
+    if(caller_size + size > MAX_FUNCTION_SIZE) return false;
+    return size <= MAX_INLINE_SIZE || (calls[g] == 1 && size <= MAX_SINGLE_SIZE);
+}
+
+// the body of the callee in place of the jal
+void Inliner::Expand(int g, InstrList& caller, std::vector<Instruction>& out) {
+    const InstrList& callee = *functions[g];
+    std::string suffix = "_inline" + std::to_string(copies++);
+    std::unordered_map<int, int> labels;
+    for(int i = callee.body; i < (int)callee.code.size(); i++) {
+        const Instruction& instr = callee.code[i];
+        if(instr.op == Op::LABEL) labels[instr.a.value] = Lbl(LabelName(instr.a.value) + suffix).value;
+    }
+    std::unordered_map<int, int> slots;     // frame offset in the callee -> frame offset in the caller
+    auto slot = [&](int offset) {
+        auto found = slots.find(offset);
+        if(found != slots.end()) return found->second;
+        int mapped = caller.NewSlot().value;
+        slots[offset] = mapped;
+        auto length = callee.array_lengths.find(offset);
+        if(length != callee.array_lengths.end()) caller.array_lengths[mapped] = length->second;
+        return mapped;
+    };
+
+    std::unordered_map<int, int> arrays;    // the same for the arrays in the frame
+    out.push_back(Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### Inlined " + callee.name + " ###"));
+    for(int i = callee.body; i < (int)callee.code.size(); i++) {
+        Instruction instr = callee.code[i];
+        if(IsStackArray(callee, instr)) {
+            if(!arrays.count(instr.c.value)) arrays[instr.c.value] = caller.NewArray(callee.stack_arrays.at(instr.c.value)).value;
+            instr.c.value = arrays[instr.c.value];
+            out.push_back(instr);
+            continue;
+        }
+        for(Operand* o : {&instr.a, &instr.b, &instr.c}) {
+            if(o->kind == Operand::LABEL && labels.count(o->value)) o->value = labels[o->value];
+            if(o->kind != Operand::MEM || o->reg != FP) continue;
+            if(o->value > 0) {
+                // the arguments the caller pushed, above $fp and $ra in the frame of a call
+                *o = Mem(o->value - 8, SP);
+            }
+            else {
+                o->value = slot(o->value);
+            }
+        }
+        out.push_back(instr);
+    }
+    out.push_back(Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### End of Inlined " + callee.name + " ###"));
+}
+
+void Inliner::InlineInto(int f) {
+    InstrList& caller = *functions[f];
+    std::vector<Instruction> code;
+    code.reserve(caller.code.size());
+    int size = Size(f);
+    for(const Instruction& instr : caller.code) {
+        int g = Callee(instr);
+        if(g < 0 || !Worth(g, size)) {
+            code.push_back(instr);
+            continue;
+        }
+        Expand(g, caller, code);
+        size += Size(g);
+        calls[g]--;
+        std::cout << "inlined '" << functions[g]->name << "' into '" << caller.name << "'\n";
+    }
+    caller.code.swap(code);
+}
+
+void Inliner::PostOrder(int f, std::vector<bool>& seen, std::vector<int>& order) const {
+    seen[f] = true;
+    for(int g : callees[f]) {
+        if(!seen[g]) PostOrder(g, seen, order);
+    }
+    order.push_back(f);
+}
+
+void Inliner::Run() {
+    std::vector<bool> seen(functions.size(), false);
+    std::vector<int> order;
+    for(int f = 0; f < (int)functions.size(); f++) {
+        if(!seen[f]) PostOrder(f, seen, order);
+    }
+    for(int f : order) InlineInto(f);
+
+    // drop the functions main does not reach any more
+    int main = functions.size() - 1;
+    std::vector<bool> reached(functions.size(), false);
+    std::vector<int> work = {main};
+    reached[main] = true;
+    while(!work.empty()) {
+        int f = work.back();
+        work.pop_back();
+        for(const Instruction& instr : functions[f]->code) {
+            int g = Callee(instr);
+            if(g >= 0 && !reached[g]) {
+                reached[g] = true;
+                work.push_back(g);
+            }
+        }
+    }
+    std::vector<InstrList*> kept;
+    for(int f = 0; f < (int)functions.size(); f++) {
+        if(reached[f]) {
+            kept.push_back(functions[f]);
+        }
+        else {
+            std::cout << "removed '" << functions[f]->name << "', it is not called any more\n";
+            delete functions[f];
+        }
+    }
+    functions.swap(kept);
+}
+
+void InlineCalls(std::vector<InstrList*>& functions) {
+    Inliner(functions).Run();
+}
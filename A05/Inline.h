@@ -0,0 +1,32 @@
+/*
+Inline.h
+Corbin Weiss
+17 October 2026
+
+Inlining of small functions into their callers
+*/
+
+/*
+*** Outline of Approach ***
+A call costs the pushes of the arguments, the jal, the prologue and epilogue of
+the callee and the copies of its parameters into their slots, which is more than
+the whole body of a small helper. Every function is generated into its own
+InstrList first, and the calls are inlined before any of them is optimized:
+  - the call graph comes from the jal instructions. A function that can reach
+    itself is never inlined, so recursion is left alone.
+  - callees are handled before their callers, so a caller takes in the already
+    inlined body of its callee
+  - a callee is inlined when its body is small, or when it is called from one
+    place only, as long as the caller does not grow too large
+  - the jal is replaced by the body of the callee without its prologue. Its slots
+    become new slots in the frame of the caller, its labels get a suffix of
+    their own for every copy, and the parameters are read from the arguments the
+    caller pushed, which are right above $sp when the body starts.
+The value left in $v0 is the same as after the call. Every inlined call is
+reported, and functions that are no longer called are dropped.
+*/
+#pragma once
+#include "Instruction.h"
+
+// inline calls between the functions, main is always the last one
+void InlineCalls(std::vector<InstrList*>& functions);
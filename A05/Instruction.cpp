@@ -0,0 +1,123 @@
+/*
+Instruction.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the operand helpers and the name tables for the instruction list
+*/
+
+#include "Instruction.h"
+#include <unordered_map>
+
+static std::vector<std::string> label_names;
+static std::unordered_map<std::string, int> label_ids;
+
+int InternLabel(const std::string& name) {
+    auto found = label_ids.find(name);
+    if(found != label_ids.end()) {
+        return found->second;
+    }
+    int id = label_names.size();
+    label_names.push_back(name);
+    label_ids[name] = id;
+    return id;
+}
+
+const std::string& LabelName(int id) {
+    return label_names[id];
+}
+
+Operand Imm(int value) {
+    return Operand(Operand::IMM, -1, value);
+}
+
+Operand Mem(int offset, int base) {
+    return Operand(Operand::MEM, base, offset);
+}
+
+Operand Lbl(const std::string& name) {
+    return Operand(Operand::LABEL, -1, InternLabel(name));
+}
+
+Operand Lbl(const char* prefix, int n) {
+    return Lbl(prefix + std::to_string(n));
+}
+
+static const char* reg_names[] = {
+    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+    "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+    "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+    "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra",
+};
+
+const char* RegName(int reg) {
+    return reg_names[reg];
+}
+
+static const char* op_names[] = {
+    "li", "la", "move", "lw", "sw",
+    "add", "addi", "addu", "addiu", "sub", "mul", "div", "rem", "and", "or", "not", "neg", "sll",
+    "seq", "sne", "sle", "sge", "slt", "sgt",
+    "beq", "bne", "blt", "ble", "bgt", "bge", "bgeu", "beqz", "bnez",
+    "j", "jal", "jr", "syscall",
+    "", "",
+};
+
+const char* OpName(Op op) {
+    return op_names[static_cast<int>(op)];
+}
+
+bool IsBranch(Op op) {
+    return op >= Op::BEQ && op <= Op::BNEZ;
+}
+
+bool IsJump(Op op) {
+    return op == Op::J || op == Op::JAL || op == Op::JR;
+}
+
+int DefReg(const Instruction& instr) {
+    switch(instr.op) {
+        case Op::SW:
+        case Op::J:
+        case Op::JR:
+        case Op::LABEL:
+        case Op::COMMENT:
+            return -1;
+        case Op::JAL:
+            return RA;
+        case Op::SYSCALL:
+            return V0;  // read integer returns its result in $v0
+        default:
+            if(IsBranch(instr.op)) return -1;
+            return instr.a.kind == Operand::REG ? instr.a.reg : -1;
+    }
+}
+
+int UseRegs(const Instruction& instr, int uses[3]) {
+    int n = 0;
+    const Operand* first = &instr.b;   // the defined register is not a use
+    if(instr.op == Op::SW || IsBranch(instr.op) || instr.op == Op::JR) {
+        first = &instr.a;
+    }
+    if(instr.op == Op::SYSCALL) {
+        uses[n++] = V0;
+        uses[n++] = A0;
+        return n;
+    }
+    for(const Operand* o : {&instr.a, &instr.b, &instr.c}) {
+        if(o < first) continue;
+        if(o->kind == Operand::REG || o->kind == Operand::MEM) {
+            uses[n++] = o->reg;
+        }
+    }
+    return n;
+}
+
+bool UsesReg(const Instruction& instr, int reg) {
+    int uses[3];
+    int n = UseRegs(instr, uses);
+    for(int i = 0; i < n; i++) {
+        if(uses[i] == reg) return true;
+    }
+    return false;
+}
@@ -0,0 +1,101 @@
+/*
+Instruction.h
+Corbin Weiss
+17 October 2026
+
+Define the in-memory MIPS instruction list that the code generator builds
+*/
+
+/*
+*** Outline of Approach ***
+EmitCode does not print assembly directly. Each function appends Instructions
+to its own InstrList, and the list is only turned into text by the Emitter once
+the whole function has been generated. This lets later passes look at and
+rewrite the code of a function before it is printed.
+An Instruction is an opcode plus up to three operands. An operand is a register,
+an immediate, a label or a memory reference offset(base). Labels are interned
+so an operand is just a few integers.
+*/
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum Register {
+    ZERO, AT, V0, V1, A0, A1, A2, A3,
+    T0, T1, T2, T3, T4, T5, T6, T7,
+    S0, S1, S2, S3, S4, S5, S6, S7,
+    T8, T9, K0, K1, GP, SP, FP, RA,
+    NUM_REGS
+};
+
+static const int NUM_ARG_REGS = 4;  // $a0-$a3 carry the first arguments with --regargs
+
+enum class Op {
+    LI, LA, MOVE, LW, SW,
+    ADD, ADDI, ADDU, ADDIU, SUB, MUL, DIV, REM, AND, OR, NOT, NEG, SLL,
+    SEQ, SNE, SLE, SGE, SLT, SGT,
+    BEQ, BNE, BLT, BLE, BGT, BGE, BGEU, BEQZ, BNEZ,
+    J, JAL, JR, SYSCALL,
+    LABEL,      // a: the label being defined
+    COMMENT,    // a comment on a line of its own
+};
+
+struct Operand {
+    enum Kind { NONE, REG, IMM, LABEL, MEM };
+    Kind kind = NONE;
+    int reg = -1;   // the register, or the base register of a memory reference
+    int value = 0;  // the immediate, the offset of a memory reference or the label id
+    Operand() {}
+    Operand(Register r) : kind(REG), reg(r) {}
+    Operand(Kind k, int r, int v) : kind(k), reg(r), value(v) {}
+};
+
+Operand Imm(int value);                 // immediate value
+Operand Mem(int offset, int base);      // offset(base)
+Operand Lbl(const std::string& name);   // a label by name
+Operand Lbl(const char* prefix, int n); // a numbered label such as _else3
+
+int InternLabel(const std::string& name);
+const std::string& LabelName(int id);
+const char* RegName(int reg);
+const char* OpName(Op op);
+
+struct Instruction {
+    Op op;
+    Operand a, b, c;
+    std::string comment;
+    Instruction(Op op, Operand a = Operand(), Operand b = Operand(), Operand c = Operand(), std::string comment = "")
+    : op(op), a(a), b(b), c(c), comment(std::move(comment)) {}
+};
+
+// register defined by an instruction, or -1. Calls and syscalls are handled by the passes.
+int DefReg(const Instruction& instr);
+// registers read by an instruction, returns how many were written to uses
+int UseRegs(const Instruction& instr, int uses[3]);
+bool UsesReg(const Instruction& instr, int reg);
+bool IsBranch(Op op);       // conditional branch to the label in its last operand
+bool IsJump(Op op);         // j, jal or jr
+
+// the code of one function, printed as a unit once it is complete
+struct InstrList {
+    std::string name;
+    std::vector<Instruction> code;
+    int body = 0;           // index of the first instruction after the prologue
+    int frame_words = 0;    // words of the frame below $fp, allocated by the prologue
+    int params = 0;         // words of arguments the caller pushes
+    int start = 0;          // index of the first instruction after the parameters are copied into their slots
+    bool tail_return = false;   // tail calls to other functions need copies of the epilogue
+    bool reg_args = false;  // the first parameters come in $a0-$a3, the others are read where they were pushed
+    std::unordered_map<int, int> array_lengths; // frame offset -> length of a local array of fixed size
+    std::unordered_map<int, int> stack_arrays;  // frame offset of the length word of an array in the frame -> its length
+    InstrList(std::string name) : name(name) {}
+    void append(Instruction instr) { code.push_back(std::move(instr)); }
+    Operand NewSlot() { return Mem(-4 * frame_words++, FP); }  // one more word in the frame
+    // the words of an array in the frame, returns its length word at the lowest address
+    Operand NewArray(int length) {
+        frame_words += length + 1;
+        stack_arrays[-4 * (frame_words - 1)] = length;
+        return Mem(-4 * (frame_words - 1), FP);
+    }
+};
@@ -0,0 +1,212 @@
+/*
+Licm.cpp
+Corbin Weiss
+17 October 2026
+
+Implement hoisting of loop-invariant expressions into a preheader
+*/
+
+#include "Licm.h"
+#include "Cfg.h"
+#include "Ssa.h"
+#include <algorithm>
+#include <unordered_set>
+
+static const int NUM_TEMPS = 10;    // $t0-$t9 are free before the loop starts
+
+// an invariant expression, with its operands as indices of other expressions
+struct Expr {
+    Op op;              // LI, LW of a slot or of a length word, or a pure operation
+    int left = -1;      // the first operand, or the array pointer of a length word
+    int right = -1;     // the second operand, -1 if it is the immediate or there is none
+    int value = 0;      // the immediate, or the frame offset of a slot
+    bool operator==(const Expr& other) const {
+        return op == other.op && left == other.left && right == other.right && value == other.value;
+    }
+};
+
+class Hoister {
+    public:
+        Hoister(InstrList& list, const Cfg& cfg, const Loop& loop) : list(list), cfg(cfg), loop(loop) {}
+        void Run();
+    private:
+        InstrList& list;
+        const Cfg& cfg;
+        const Loop& loop;
+        std::vector<Expr> exprs;
+        std::unordered_set<int> stored;     // offsets of the slots stored in the loop
+
+        int Intern(Expr expr);
+        int ExprOf(const Instruction& instr, const std::vector<int>& regs, bool in_header);
+        int Need(int e) const;
+        void Emit(int e, int reg, std::vector<Instruction>& out) const;
+};
+
+static Register Temp(int reg) {
+    static const Register temps[NUM_TEMPS] = {T0, T1, T2, T3, T4, T5, T6, T7, T8, T9};
+    return temps[reg];
+}
+
+int Hoister::Intern(Expr expr) {
+    auto found = std::find(exprs.begin(), exprs.end(), expr);
+    if(found != exprs.end()) return found - exprs.begin();
+    exprs.push_back(expr);
+    return exprs.size() - 1;
+}
+
+// the invariant expression an instruction computes, or -1
+int Hoister::ExprOf(const Instruction& instr, const std::vector<int>& regs, bool in_header) {
+    auto reg = [&](const Operand& o) { return o.kind == Operand::REG ? regs[o.reg] : -1; };
+    switch(instr.op) {
+        case Op::LI:
+            return Intern({Op::LI, -1, -1, instr.b.value});
+        case Op::MOVE:
+            return reg(instr.b);
+        case Op::LW:
+            if(IsSlotAccess(instr)) {
+                return stored.count(instr.b.value) ? -1 : Intern({Op::LW, -1, -1, instr.b.value});
+            }
+            // the length word at the start of an array
+            if(instr.b.value == 0 && instr.b.reg != SP && instr.b.reg != FP) {
+                int base = regs[instr.b.reg];
+                if(base >= 0 && exprs[base].op == Op::LW && exprs[base].left < 0) return Intern({Op::LW, base, -1, 0});
+            }
+            return -1;
+        case Op::ADD: case Op::ADDI: case Op::SUB: case Op::NEG:
+            if(!in_header) return -1;   // may trap on overflow
+            [[fallthrough]];
+        case Op::MUL: case Op::AND: case Op::OR: case Op::NOT: case Op::SLL:
+        case Op::SEQ: case Op::SNE: case Op::SLE: case Op::SGE: case Op::SLT: case Op::SGT: {
+            int left = reg(instr.b);
+            if(left < 0) return -1;
+            if(instr.c.kind == Operand::REG) {
+                int right = reg(instr.c);
+                return right < 0 ? -1 : Intern({instr.op, left, right, 0});
+            }
+            return Intern({instr.op, left, -1, instr.c.kind == Operand::IMM ? instr.c.value : 0});
+        }
+        default:
+            return -1;
+    }
+}
+
+// the temporaries needed to compute an expression
+int Hoister::Need(int e) const {
+    const Expr& expr = exprs[e];
+    if(expr.left < 0) return 1;
+    int left = Need(expr.left);
+    if(expr.right < 0) return left;
+    return std::max(left, Need(expr.right) + 1);
+}
+
+void Hoister::Emit(int e, int reg, std::vector<Instruction>& out) const {
+    const Expr& expr = exprs[e];
+    Register dest = Temp(reg);
+    if(expr.op == Op::LI) {
+        out.push_back(Instruction(Op::LI, dest, Imm(expr.value)));
+    }
+    else if(expr.op == Op::LW && expr.left < 0) {
+        out.push_back(Instruction(Op::LW, dest, Mem(expr.value, FP)));
+    }
+    else if(expr.op == Op::LW) {
+        Emit(expr.left, reg, out);
+        out.push_back(Instruction(Op::LW, dest, Mem(0, dest), Operand(), "get the length of the array"));
+    }
+    else if(expr.right >= 0) {
+        Emit(expr.left, reg, out);
+        Emit(expr.right, reg + 1, out);
+        out.push_back(Instruction(expr.op, dest, dest, Temp(reg + 1)));
+    }
+    else {
+        Emit(expr.left, reg, out);
+        bool unary = expr.op == Op::NOT || expr.op == Op::NEG;
+        out.push_back(Instruction(expr.op, dest, dest, unary ? Operand() : Imm(expr.value)));
+    }
+}
+
+void Hoister::Run() {
+    std::vector<Instruction>& code = list.code;
+    if(!cfg.HasPreheader(loop, code)) return;
+    for(int b : loop.blocks) {
+        for(int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            if(IsSlotAccess(code[i]) && code[i].op == Op::SW) stored.insert(code[i].b.value);
+        }
+    }
+
+    // find the roots: invariant results that are read by code that is not invariant
+    std::vector<int> root_expr(code.size(), -1);
+    for(int b : loop.blocks) {
+        std::vector<int> regs(NUM_REGS, -1);    // the invariant expression in each register
+        std::vector<int> defs(NUM_REGS, -1);    // the instruction that computed it
+        regs[ZERO] = Intern({Op::LI, -1, -1, 0});
+        auto keep = [&](int reg) {
+            // constants and slots are as cheap to load in the loop as before it
+            if(defs[reg] >= 0 && exprs[regs[reg]].left >= 0) root_expr[defs[reg]] = regs[reg];
+        };
+        // an op that may trap is only hoisted while nothing observable has happened in the
+        // header yet: no call, output, store or check may run before it in the loop
+        bool in_header = b == loop.header;
+        for(int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            const Instruction& instr = code[i];
+            int e = ExprOf(instr, regs, in_header);
+            if(instr.op == Op::JAL || instr.op == Op::SYSCALL || instr.op == Op::SW || IsBranch(instr.op)) in_header = false;
+            if(e < 0) {
+                int uses[3];
+                int n = UseRegs(instr, uses);
+                for(int k = 0; k < n; k++) keep(uses[k]);
+            }
+            if(instr.op == Op::JAL) {
+                std::fill(regs.begin() + 1, regs.end(), -1);
+                std::fill(defs.begin(), defs.end(), -1);
+                regs[ZERO] = Intern({Op::LI, -1, -1, 0});
+                continue;
+            }
+            int def = DefReg(instr);
+            if(def <= 0) continue;
+            regs[def] = e;
+            defs[def] = e < 0 ? -1 : i;
+        }
+        // values still in registers may be read by the next block
+        for(int reg = 1; reg < NUM_REGS; reg++) keep(reg);
+    }
+
+    // compute each root once before the loop and load it where it was computed
+    std::vector<Instruction> preheader = {Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### Loop Invariants ###")};
+    std::vector<Operand> slots(exprs.size());
+    for(int i = 0; i < (int)code.size(); i++) {
+        int e = root_expr[i];
+        if(e < 0 || Need(e) > NUM_TEMPS) continue;
+        if(slots[e].kind == Operand::NONE) {
+            slots[e] = list.NewSlot();
+            Emit(e, 0, preheader);
+            preheader.push_back(Instruction(Op::SW, T0, slots[e], Operand(), "save the loop invariant"));
+        }
+        code[i] = Instruction(Op::LW, code[i].a, slots[e], Operand(), code[i].comment);
+    }
+    if(preheader.size() > 1) {
+        code.insert(code.begin() + cfg.blocks[loop.header].begin, preheader.begin(), preheader.end());
+    }
+}
+
+void HoistInvariants(InstrList& list) {
+    // the labels of the loop headers, outer loops first
+    std::vector<int> headers;
+    {
+        Cfg cfg(list);
+        for(const Loop& loop : cfg.loops) {
+            const Instruction& first = list.code[cfg.blocks[loop.header].begin];
+            if(first.op == Op::LABEL) headers.push_back(first.a.value);
+        }
+    }
+    // hoisting moves the instructions, so the graph is built again for every loop
+    for(int label : headers) {
+        Cfg cfg(list);
+        for(const Loop& loop : cfg.loops) {
+            const BasicBlock& header = cfg.blocks[loop.header];
+            if(list.code[header.begin].op == Op::LABEL && list.code[header.begin].a.value == label) {
+                Hoister(list, cfg, loop).Run();
+                break;
+            }
+        }
+    }
+}
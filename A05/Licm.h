@@ -0,0 +1,31 @@
+/*
+Licm.h
+Corbin Weiss
+17 October 2026
+
+Loop-invariant code motion for the while loops of a function
+*/
+
+/*
+*** Outline of Approach ***
+The body and condition of a while loop are evaluated again on every iteration,
+including parts that cannot change inside the loop, such as the length of an
+array or arithmetic on parameters. The pass works on the instruction list before
+the locals are allocated, one loop at a time from the outermost:
+  - a slot that is not stored anywhere in the loop is invariant, and so are
+    constants, the length word of an invariant array pointer (element stores
+    never write it) and the result of a pure operation on invariant operands
+  - the blocks of the loop are simulated with the expression each register
+    holds. An instruction whose result is an invariant expression that is read
+    by code that is not itself invariant is a root.
+  - every root expression is computed once in a preheader before the label of
+    the loop header and stored in a new slot of the frame. The root instruction
+    becomes a load of that slot, which the register allocator then keeps in an
+    $s register, and the instructions that only fed it are removed as dead later.
+An add, sub or neg can trap on overflow, so they are only hoisted from the
+header, which runs whenever the preheader does.
+*/
+#pragma once
+#include "Instruction.h"
+
+void HoistInvariants(InstrList& list);
@@ -0,0 +1,447 @@
+/*
+Peephole.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the peephole optimizer for push/pop pairs and redundant loads
+*/
+
+#include "Peephole.h"
+#include <cstdint>
+#include <unordered_map>
+
+// a set of registers, one bit per register
+typedef uint32_t RegSet;
+
+static RegSet Bit(int reg) {
+    return reg >= 0 ? 1u << reg : 0;
+}
+
+static RegSet Range(int first, int last) {
+    RegSet set = 0;
+    for(int r = first; r <= last; r++) set |= Bit(r);
+    return set;
+}
+
+// registers a called function may overwrite. $a0-$a3 are left out, which only keeps
+// the arguments live a little longer than they have to be
+static const RegSet CALL_CLOBBERED = Bit(AT) | Bit(V0) | Bit(V1) | Range(T0, T7) | Bit(T8) | Bit(T9) | Bit(RA);
+// registers the caller of a function may still need when it returns
+static const RegSet LIVE_AT_RETURN = Bit(V0) | Range(S0, S7) | Bit(SP) | Bit(FP) | Bit(RA);
+static const RegSet ALL_REGS = 0xffffffffu;
+
+static const int WINDOW = 16;       // how far to look ahead for a matching load
+static const int MAX_PASSES = 32;   // nested expressions need one pass per level
+
+// instructions that only compute their destination and can be removed if it is never read
+static bool IsPure(Op op) {
+    switch(op) {
+        case Op::LI: case Op::LA: case Op::MOVE: case Op::LW:
+        case Op::ADDU: case Op::ADDIU: case Op::MUL:
+        case Op::AND: case Op::OR: case Op::NOT: case Op::SLL:
+        case Op::SEQ: case Op::SNE: case Op::SLE: case Op::SGE: case Op::SLT: case Op::SGT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// arithmetic that stops the program when it overflows, so it stays even if its result is never read
+static bool MayTrap(Op op) {
+    return op == Op::ADD || op == Op::ADDI || op == Op::SUB || op == Op::NEG;
+}
+
+static Operand Reg(int reg) {
+    return Operand(Operand::REG, reg, 0);
+}
+
+static bool IsDeleted(const Instruction& instr) {
+    return instr.op == Op::COMMENT && instr.comment.empty();
+}
+
+static void Delete(Instruction& instr) {
+    instr = Instruction(Op::COMMENT);
+}
+
+// labels, branches, jumps and syscalls end a straight-line window
+static bool IsBarrier(const Instruction& instr) {
+    return instr.op == Op::LABEL || IsBranch(instr.op) || IsJump(instr.op) || instr.op == Op::SYSCALL;
+}
+
+static bool IsStackAdjust(const Instruction& instr) {
+    return instr.op == Op::ADDI && instr.a.reg == SP && instr.b.reg == SP && instr.c.kind == Operand::IMM;
+}
+
+static bool IsPush(const std::vector<Instruction>& code, int i) {
+    return i + 1 < (int)code.size() && IsStackAdjust(code[i]) && code[i].c.value == -4
+        && code[i+1].op == Op::SW && code[i+1].a.reg != SP && code[i+1].b.reg == SP && code[i+1].b.value == 4;
+}
+
+static bool IsPop(const std::vector<Instruction>& code, int i) {
+    return i + 1 < (int)code.size() && code[i].op == Op::LW && code[i].a.reg != SP
+        && code[i].b.reg == SP && code[i].b.value == 4
+        && IsStackAdjust(code[i+1]) && code[i+1].c.value == 4;
+}
+
+static bool References(const Instruction& instr, int reg) {
+    return DefReg(instr) == reg || UsesReg(instr, reg);
+}
+
+// replace every read of register from in instr with register to
+static void ReplaceUses(Instruction& instr, int from, int to) {
+    Operand* first = &instr.b;
+    if(instr.op == Op::SW || IsBranch(instr.op) || instr.op == Op::JR) {
+        first = &instr.a;
+    }
+    for(Operand* o : {&instr.a, &instr.b, &instr.c}) {
+        if(o < first) continue;
+        if((o->kind == Operand::REG || o->kind == Operand::MEM) && o->reg == from) {
+            o->reg = to;
+        }
+    }
+}
+
+static void UseDef(const Instruction& instr, RegSet& use, RegSet& def) {
+    use = def = 0;
+    switch(instr.op) {
+        case Op::JAL:
+            use = Range(A0, A3) | Bit(SP) | Bit(FP);
+            def = CALL_CLOBBERED;
+            return;
+        case Op::SYSCALL:
+            use = Bit(V0) | Range(A0, A1);
+            def = Bit(V0);
+            return;
+        case Op::JR:
+            use = Bit(instr.a.reg) | LIVE_AT_RETURN;
+            return;
+        default:
+            int uses[3];
+            int n = UseRegs(instr, uses);
+            for(int k = 0; k < n; k++) use |= Bit(uses[k]);
+            def = Bit(DefReg(instr));
+            return;
+    }
+}
+
+// the runtime error handlers print a message and exit without reading any register
+static bool IsErrorHandler(const Operand& l) {
+    return LabelName(l.value).rfind("__error_", 0) == 0;
+}
+
+/*
+    Compute the registers that are live after each instruction.
+    Branches and jumps to other labels outside of this function keep every register live.
+*/
+static std::vector<RegSet> Liveness(const std::vector<Instruction>& code) {
+    int n = code.size();
+    std::unordered_map<int, int> labels;
+    for(int i = 0; i < n; i++) {
+        if(code[i].op == Op::LABEL) labels[code[i].a.value] = i;
+    }
+    auto target = [&](const Operand& l) {
+        auto found = labels.find(l.value);
+        return found == labels.end() ? -1 : found->second;
+    };
+    std::vector<RegSet> live_in(n + 1, 0), live_out(n, 0);
+    live_in[n] = ALL_REGS;     // falling off the end of the list
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(int i = n - 1; i >= 0; i--) {
+            const Instruction& instr = code[i];
+            RegSet out = 0;
+            if(instr.op == Op::J) {
+                int t = target(instr.a);
+                out = t < 0 ? ALL_REGS : live_in[t];
+            }
+            else if(IsBranch(instr.op)) {
+                const Operand& l = instr.c.kind == Operand::LABEL ? instr.c : instr.b;
+                int t = target(l);
+                RegSet taken = t >= 0 ? live_in[t] : IsErrorHandler(l) ? 0 : ALL_REGS;
+                out = live_in[i+1] | taken;
+            }
+            else if(instr.op != Op::JR) {
+                out = live_in[i+1];
+            }
+            RegSet use, def;
+            UseDef(instr, use, def);
+            RegSet in = (out & ~def) | use;
+            if(in != live_in[i] || out != live_out[i]) {
+                live_in[i] = in;
+                live_out[i] = out;
+                changed = true;
+            }
+        }
+    }
+    return live_out;
+}
+
+/*
+    push rA; ...; pop rB  ==>  ...; move rB, rA
+    The instructions in between may not touch $sp or leave the window
+    and must not overwrite rA.
+*/
+static bool ForwardPushPop(std::vector<Instruction>& code, int i) {
+    if(!IsPush(code, i)) return false;
+    int reg = code[i+1].a.reg;
+    for(int j = i + 2; j < (int)code.size(); j++) {
+        const Instruction& instr = code[j];
+        if(IsDeleted(instr) || instr.op == Op::COMMENT) continue;
+        if(IsPop(code, j)) {
+            int dest = code[j].a.reg;
+            Delete(code[i]);
+            Delete(code[i+1]);
+            if(dest == reg) {
+                Delete(code[j]);
+            }
+            else {
+                code[j] = Instruction(Op::MOVE, Reg(dest), Reg(reg), Operand(), code[j].comment);
+            }
+            Delete(code[j+1]);
+            return true;
+        }
+        if(IsBarrier(instr) || References(instr, SP) || DefReg(instr) == reg) return false;
+    }
+    return false;
+}
+
+/*
+    Same as ForwardPushPop, but for a pushed register that is overwritten before
+    the pop. The value is kept in a temporary register that is free over the
+    whole window instead: push rA ... pop rB  ==>  move rT, rA ... move rB, rT
+*/
+static bool RenamePushPop(std::vector<Instruction>& code, std::vector<RegSet>& live, int i) {
+    if(!IsPush(code, i)) return false;
+    int reg = code[i+1].a.reg;
+    RegSet busy = live[i+1] | Bit(reg);
+    int j = i + 2;
+    for(; j < (int)code.size(); j++) {
+        const Instruction& instr = code[j];
+        if(IsDeleted(instr) || instr.op == Op::COMMENT) continue;
+        if(IsPop(code, j)) break;
+        if(IsBarrier(instr) || References(instr, SP)) return false;
+        RegSet use, def;
+        UseDef(instr, use, def);
+        busy |= use | def;
+    }
+    if(j >= (int)code.size()) return false;
+    int temp = -1;
+    for(int r : {T0, T1, T2, T3, T4, T5, T6, T7, T8, T9}) {
+        if(!(busy & Bit(r))) {
+            temp = r;
+            break;
+        }
+    }
+    if(temp < 0) return false;
+    code[i] = Instruction(Op::MOVE, Reg(temp), Reg(reg), Operand(), "keep the value in a free register");
+    Delete(code[i+1]);
+    code[j] = Instruction(Op::MOVE, code[j].a, Reg(temp), Operand(), code[j].comment);
+    Delete(code[j+1]);
+    for(int k = i; k < j; k++) live[k] |= Bit(temp);
+    return true;
+}
+
+/*
+    Slide an adjustment of $sp towards the previous (for allocations) or next
+    (for releases) adjustment and merge the two. Loads and stores relative to $sp
+    that it moves past have their offsets corrected, so the values on the stack
+    always stay above $sp.
+*/
+static bool MergeStackAdjust(std::vector<Instruction>& code, int i) {
+    if(!IsStackAdjust(code[i])) return false;
+    int amount = code[i].c.value;
+    int step = amount < 0 ? -1 : 1;
+    std::vector<int> moved;
+    for(int j = i + step; j >= 0 && j < (int)code.size(); j += step) {
+        Instruction& instr = code[j];
+        if(IsDeleted(instr) || instr.op == Op::COMMENT) continue;
+        if(IsStackAdjust(instr)) {
+            for(int k : moved) code[k].b.value += amount < 0 ? -amount : amount;
+            instr.c.value += amount;
+            Delete(code[i]);
+            if(instr.c.value == 0) Delete(instr);
+            return true;
+        }
+        if(IsBarrier(instr)) return false;
+        if((instr.op == Op::LW || instr.op == Op::SW) && instr.b.reg == SP && instr.a.reg != SP) {
+            moved.push_back(j);
+            continue;
+        }
+        if(References(instr, SP)) return false;
+    }
+    return false;
+}
+
+/*
+    sw/lw rA, k(B); ...; lw rC, k(B)  ==>  sw/lw rA, k(B); ...; move rC, rA
+    as long as neither rA nor B change and nothing may have stored to k(B) in between.
+    Only a store through the same base register at another offset is known not to alias.
+*/
+static bool RemoveReload(std::vector<Instruction>& code, int i) {
+    const Instruction& first = code[i];
+    if(first.op != Op::LW && first.op != Op::SW) return false;
+    int reg = first.a.reg;
+    int base = first.b.reg;
+    int offset = first.b.value;
+    if(reg == base || reg == ZERO) return false;
+    bool changed = false;
+    int seen = 0;
+    for(int j = i + 1; j < (int)code.size() && seen < WINDOW; j++) {
+        Instruction& instr = code[j];
+        if(IsDeleted(instr) || instr.op == Op::COMMENT) continue;
+        seen++;
+        if(IsBarrier(instr)) break;
+        if(instr.op == Op::LW && instr.b.reg == base && instr.b.value == offset) {
+            if(instr.a.reg == reg) {
+                Delete(instr);
+                changed = true;
+                continue;
+            }
+            instr = Instruction(Op::MOVE, instr.a, Reg(reg), Operand(), instr.comment);
+            changed = true;
+        }
+        else if(instr.op == Op::SW && (instr.b.reg != base || instr.b.value == offset)) {
+            break;
+        }
+        int def = DefReg(instr);
+        if(def == reg || def == base) break;
+    }
+    return changed;
+}
+
+/*
+    move rB, rS; ... rB ...  ==>  move rB, rS; ... rS ...
+    Reads of rB are replaced by rS until either register changes, so that the
+    move is left dead when rB is not needed any more.
+*/
+static bool PropagateCopy(std::vector<Instruction>& code, int i) {
+    const Instruction& move = code[i];
+    if(move.op != Op::MOVE) return false;
+    int dest = move.a.reg;
+    int src = move.b.reg;
+    if(dest == src || dest == SP || dest == FP) return false;
+    // registers read by calls and syscalls without appearing as an operand
+    RegSet implicit = Range(A0, A3) | Bit(V0);
+    bool changed = false;
+    for(int j = i + 1; j < (int)code.size(); j++) {
+        Instruction& instr = code[j];
+        if(IsDeleted(instr) || instr.op == Op::COMMENT) continue;
+        if(instr.op == Op::LABEL) break;
+        if((instr.op == Op::JAL || instr.op == Op::SYSCALL) && (implicit & Bit(dest))) break;
+        if(UsesReg(instr, dest)) {
+            ReplaceUses(instr, dest, src);
+            changed = true;
+        }
+        if(IsBarrier(instr)) break;
+        int def = DefReg(instr);
+        if(def == dest || def == src) break;
+    }
+    return changed;
+}
+
+/*
+    op rD, ...; move rX, rD  ==>  op rX, ...
+    when rD is not read after the move.
+*/
+static bool ForwardResult(std::vector<Instruction>& code, std::vector<RegSet>& live, int i) {
+    Instruction& instr = code[i];
+    if(!(IsPure(instr.op) || MayTrap(instr.op)) || instr.a.kind != Operand::REG) return false;
+    int reg = instr.a.reg;
+    if(reg == SP || reg == FP || reg == RA) return false;
+    int j = i + 1;
+    while(j < (int)code.size() && code[j].op == Op::COMMENT) j++;
+    if(j >= (int)code.size()) return false;
+    Instruction& move = code[j];
+    if(move.op != Op::MOVE || move.b.reg != reg) return false;
+    int dest = move.a.reg;
+    if(dest == SP || dest == FP || dest == ZERO || (live[j] & Bit(reg))) return false;
+    instr.a.reg = dest;
+    if(instr.comment.empty()) instr.comment = move.comment;
+    Delete(move);
+    live[i] = live[j];
+    return true;
+}
+
+/*
+    j L; L:  ==>  L:
+    A jump to a label that directly follows it, with only other labels in between,
+    as left behind by an if without an else or by a branch that became a jump.
+*/
+static bool RemoveJumpToNext(std::vector<Instruction>& code, int i) {
+    if(code[i].op != Op::J) return false;
+    for(int j = i + 1; j < (int)code.size(); j++) {
+        if(code[j].op == Op::COMMENT) continue;
+        if(code[j].op != Op::LABEL) return false;
+        if(code[j].a.value == code[i].a.value) {
+            Delete(code[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool RemoveDead(std::vector<Instruction>& code, const std::vector<RegSet>& live, int i) {
+    Instruction& instr = code[i];
+    if(instr.op == Op::MOVE && instr.a.reg == instr.b.reg) {
+        Delete(instr);
+        return true;
+    }
+    if(IsStackAdjust(instr) && instr.c.value == 0) {
+        Delete(instr);
+        return true;
+    }
+    if(!IsPure(instr.op) || instr.a.kind != Operand::REG) return false;
+    int reg = instr.a.reg;
+    if(reg == SP || reg == FP || reg == RA || (live[i] & Bit(reg))) return false;
+    Delete(instr);
+    return true;
+}
+
+static void Compact(std::vector<Instruction>& code) {
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < code.size(); i++) {
+        if(!IsDeleted(code[i])) {
+            if(n != i) code[n] = std::move(code[i]);
+            n++;
+        }
+    }
+    code.erase(code.begin() + n, code.end());
+}
+
+void Peephole(InstrList& list) {
+    std::vector<Instruction>& code = list.code;
+    for(int pass = 0; pass < MAX_PASSES; pass++) {
+        bool changed = false;
+        // rules that only look at the window itself
+        for(int i = 0; i < (int)code.size(); i++) {
+            if(IsDeleted(code[i])) continue;
+            changed |= ForwardPushPop(code, i);
+            if(IsDeleted(code[i])) continue;
+            changed |= RemoveReload(code, i);
+            changed |= PropagateCopy(code, i);
+            changed |= RemoveJumpToNext(code, i);
+        }
+        Compact(code);
+        // rules that need to know which registers are still read later
+        std::vector<RegSet> live = Liveness(code);
+        for(int i = 0; i < (int)code.size(); i++) {
+            if(IsDeleted(code[i])) continue;
+            changed |= RenamePushPop(code, live, i);
+            if(ForwardResult(code, live, i)) {
+                changed = true;
+                continue;
+            }
+            changed |= RemoveDead(code, live, i);
+        }
+        Compact(code);
+        // merging $sp adjustments hides the push/pop pairs, so it waits until they are gone
+        if(!changed) {
+            for(int i = 0; i < (int)code.size(); i++) {
+                if(!IsDeleted(code[i])) changed |= MergeStackAdjust(code, i);
+            }
+            Compact(code);
+        }
+        if(!changed) break;
+    }
+}
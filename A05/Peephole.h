@@ -0,0 +1,24 @@
+/*
+Peephole.h
+Corbin Weiss
+17 October 2026
+
+Peephole optimizer for the instruction list of a function
+*/
+
+/*
+*** Outline of Approach ***
+The stack machine code generator pushes the result of every expression and pops
+it again right away in the parent node. The peephole pass looks at a small window
+of straight-line instructions at a time and
+  - turns a push that is followed by a pop into a register move,
+  - renames a value into the register it is moved to when the original dies,
+  - merges adjacent adjustments of $sp, sliding them past $sp-relative loads and stores,
+  - replaces a load of a word that is already in a register with a move,
+  - removes a jump to the label right after it.
+The rules are applied until none of them changes the code.
+*/
+#pragma once
+#include "Instruction.h"
+
+void Peephole(InstrList& list);
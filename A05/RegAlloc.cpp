@@ -0,0 +1,209 @@
+/*
+RegAlloc.cpp
+Corbin Weiss
+17 October 2026
+
+Implement linear scan allocation of local variable slots to the $s registers
+*/
+
+#include "RegAlloc.h"
+#include "Ssa.h"
+#include <algorithm>
+
+static const Register saved_regs[] = {S0, S1, S2, S3, S4, S5, S6, S7};
+// caller-saved registers a function that calls nothing may keep its variables in
+static const Register scratch_regs[] = {T9, T8, T7, T6, T5, T4, T3, T2, T1, T0, V1, A3, A2, A1};
+static const int MAX_LOOP_WEIGHT = 6;   // uses inside deeper loops all count as 10^6
+static const int SAVE_WEIGHT = 2;       // the save and restore of an $s register cost as much as a store and a load
+
+struct Interval {
+    int start = -1;     // first instruction where the web is live
+    int end = -1;       // last instruction where the web is live
+    long weight = 0;    // uses of the web, weighted by loop depth
+    int reg = -1;       // index into the registers of the function, or -1 if the web stays in its slot
+    bool calls = false; // a jal inside the interval overwrites the caller-saved registers
+};
+
+struct Liveness {
+    std::vector<std::vector<bool>> in;      // webs live on entry to each instruction
+    std::vector<std::vector<bool>> out;     // webs live after each instruction
+};
+
+/*
+    Compute whether each web is live before and after each instruction.
+    Branches out of the function go to the runtime error handlers, where nothing is live.
+*/
+static Liveness WebLiveness(const std::vector<Instruction>& code, const std::vector<int>& web_of,
+                            const Cfg& cfg, int num_webs) {
+    int n = code.size();
+    Liveness live = {std::vector<std::vector<bool>>(n, std::vector<bool>(num_webs, false)),
+                     std::vector<std::vector<bool>>(n, std::vector<bool>(num_webs, false))};
+    // iterate over the blocks until the live-in sets of their first instructions stop changing
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto b = cfg.order.rbegin(); b != cfg.order.rend(); ++b) {
+            const BasicBlock& block = cfg.blocks[*b];
+            if(block.begin == block.end) continue;
+            std::vector<bool> current(num_webs, false);
+            for(int s : block.succs) {
+                if(cfg.blocks[s].begin == cfg.blocks[s].end) continue;
+                const std::vector<bool>& in = live.in[cfg.blocks[s].begin];
+                for(int k = 0; k < num_webs; k++) if(in[k]) current[k] = true;
+            }
+            for(int i = block.end - 1; i >= block.begin; i--) {
+                live.out[i] = current;
+                if(web_of[i] >= 0) current[web_of[i]] = code[i].op == Op::LW;
+                if(i == block.begin && current != live.in[i]) changed = true;
+                live.in[i] = current;
+            }
+        }
+    }
+    return live;
+}
+
+/*
+    The registers the webs of a function can be allocated to: first the caller-saved
+    registers its code does not touch, which it does not have to save, and the $s
+    registers after them.
+*/
+static std::vector<Register> Registers(const std::vector<Instruction>& code) {
+    std::vector<Register> regs;
+    for(Register reg : scratch_regs) {
+        bool touched = std::any_of(code.begin(), code.end(),
+            [reg](const Instruction& instr) { return DefReg(instr) == reg || UsesReg(instr, reg); });
+        if(!touched) regs.push_back(reg);
+    }
+    regs.insert(regs.end(), std::begin(saved_regs), std::end(saved_regs));
+    return regs;
+}
+
+static bool CalleeSaved(Register reg) {
+    return reg >= S0 && reg <= S7;
+}
+
+std::vector<SavedReg> AllocateLocals(InstrList& list) {
+    std::vector<Instruction>& code = list.code;
+    int n = code.size();
+    std::vector<Register> regs = Registers(code);
+    int num_regs = regs.size();
+
+    // put the slots in SSA form and number the webs of their values
+    Cfg cfg(list);
+    Ssa ssa(list, cfg);
+    if(ssa.NumSlots() == 0) return {};
+    std::vector<int> webs = ssa.Webs();
+    int num_webs = *std::max_element(webs.begin(), webs.end()) + 1;
+    std::vector<int> web_of(n, -1);             // web loaded or stored by each instruction
+    for(int i = 0; i < n; i++) {
+        if(ssa.value_of[i] >= 0) web_of[i] = webs[ssa.value_of[i]];
+    }
+    Liveness live = WebLiveness(code, web_of, cfg, num_webs);
+
+    // build the live intervals
+    std::vector<Interval> intervals(num_webs);
+    for(int i = 0; i < n; i++) {
+        for(int w = 0; w < num_webs; w++) {
+            if(live.in[i][w] || (web_of[i] == w && live.out[i][w])) {
+                if(intervals[w].start < 0) intervals[w].start = i;
+                intervals[w].end = i;
+            }
+        }
+        if(web_of[i] >= 0) {
+            long weight = 1;
+            for(int d = 0; d < std::min(cfg.Depth(cfg.block_of[i]), MAX_LOOP_WEIGHT); d++) weight *= 10;
+            intervals[web_of[i]].weight += weight;
+        }
+    }
+    for(int i = 0; i < n; i++) {
+        if(code[i].op != Op::JAL) continue;
+        for(Interval& interval : intervals) {
+            if(interval.start <= i && i <= interval.end) interval.calls = true;
+        }
+    }
+
+    // linear scan over the intervals in order of their start
+    std::vector<Interval*> order;
+    for(Interval& interval : intervals) {
+        if(interval.start >= 0) order.push_back(&interval);
+    }
+    std::sort(order.begin(), order.end(), [](Interval* a, Interval* b) { return a->start < b->start; });
+    std::vector<Interval*> active;
+    std::vector<bool> free_regs(num_regs, true);
+    std::vector<bool> opened(num_regs, false);  // a web was already allocated to the register
+    for(Interval* current : order) {
+        // free the registers of intervals that have ended
+        for(auto it = active.begin(); it != active.end();) {
+            if((*it)->end < current->start) {
+                free_regs[(*it)->reg] = true;
+                it = active.erase(it);
+            }
+            else ++it;
+        }
+        // a web that is only stored and loaded once does not pay for saving another $s register
+        auto fits = [&](int reg) {
+            if(!CalleeSaved(regs[reg])) return !current->calls;
+            return opened[reg] || current->weight > SAVE_WEIGHT;
+        };
+        int reg = 0;
+        while(reg < num_regs && !(free_regs[reg] && fits(reg))) reg++;
+        if(reg < num_regs) {
+            current->reg = reg;
+            free_regs[reg] = false;
+            opened[reg] = true;
+            active.push_back(current);
+            continue;
+        }
+        // no register left: the least used of the active webs whose register fits and this one stays in memory
+        auto coldest = active.end();
+        for(auto it = active.begin(); it != active.end(); ++it) {
+            if(fits((*it)->reg) && (coldest == active.end() || (*it)->weight < (*coldest)->weight)) coldest = it;
+        }
+        if(coldest != active.end() && (*coldest)->weight < current->weight) {
+            current->reg = (*coldest)->reg;
+            (*coldest)->reg = -1;
+            *coldest = current;
+        }
+    }
+
+    // rewrite the loads and stores of the allocated webs
+    std::vector<bool> used(num_regs, false);
+    for(int i = 0; i < n; i++) {
+        int w = web_of[i];
+        if(w < 0) continue;
+        Instruction& instr = code[i];
+        if(intervals[w].start < 0) {
+            // the web is never read: all its stores are dead. Only the store goes, the value
+            // it stored is still computed, as an add that overflows has to stop the program
+            instr = Instruction(Op::COMMENT);
+            continue;
+        }
+        int reg = intervals[w].reg;
+        if(reg < 0) continue;
+        used[reg] = true;
+        Operand home(regs[reg]);
+        if(instr.op == Op::LW) {
+            instr = Instruction(Op::MOVE, instr.a, home, Operand(), instr.comment);
+        }
+        else if(live.out[i][w]) {
+            instr = Instruction(Op::MOVE, home, instr.a, Operand(), instr.comment);
+        }
+        else {
+            instr = Instruction(Op::COMMENT);   // dead store, its value is still computed
+        }
+    }
+
+    // save the registers in new slots of the frame right after the prologue
+    std::vector<SavedReg> saved;
+    std::vector<Instruction> saves;
+    for(int reg = 0; reg < num_regs; reg++) {
+        if(!used[reg] || !CalleeSaved(regs[reg])) continue;
+        Operand slot = list.NewSlot();
+        saved.push_back({regs[reg], slot.value});
+        saves.push_back(Instruction(Op::SW, regs[reg], slot, Operand(), "save the callee-saved register"));
+    }
+    code.insert(code.begin() + list.body, saves.begin(), saves.end());
+    code.erase(std::remove_if(code.begin(), code.end(),
+        [](const Instruction& instr) { return instr.op == Op::COMMENT && instr.comment.empty(); }), code.end());
+    return saved;
+}
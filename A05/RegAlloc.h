@@ -0,0 +1,36 @@
+/*
+RegAlloc.h
+Corbin Weiss
+17 October 2026
+
+Linear scan allocation of local variables and parameters to the $s registers
+*/
+
+/*
+*** Outline of Approach ***
+Every local variable and parameter has a slot at a fixed offset below $fp, and
+the code generator reads and writes it with lw/sw off($fp). Once the body of a
+function has been generated the slots are put into SSA form, and the webs of
+values that phi nodes join are treated as virtual registers:
+  - liveness analysis over the control flow graph gives each web a live interval
+  - the intervals are allocated to $s0-$s7 by linear scan. When they run out the
+    web with the lowest use count, weighted by the depth of the loops in the
+    control flow graph, stays in its slot.
+  - the loads and stores of allocated webs become moves, stores of dead values go away.
+The $s registers are callee-saved. A used register is saved in a new word of
+the frame right after the prologue, and restored by the epilogue. A web whose
+interval contains no jal first gets the caller-saved $t, $v1 and $a1-$a3
+registers the code of the function does not touch, which need no saving at all.
+A web that is stored and loaded only once, like most words of the expression
+stack, only gets an $s register that is already saved for another web.
+*/
+#pragma once
+#include "Instruction.h"
+
+struct SavedReg {
+    Register reg;
+    int offset;     // frame offset relative to $fp where reg was saved
+};
+
+// promote the $fp slots of the function body in list, returns the registers the epilogue must restore
+std::vector<SavedReg> AllocateLocals(InstrList& list);
@@ -0,0 +1,77 @@
+/*
+Runtime.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the tracking of the runtime pieces a program uses
+*/
+
+#include "Runtime.h"
+#include "malloc.h"
+#include "print.h"
+
+Runtime::Runtime(bool debug_heap) {
+    Add("true", "\ttrue: .asciiz \"true\"\t# define the true string\n", true);
+    Add("false", "\tfalse: .asciiz \"false\"\t# define the false string\n", true);
+    Add("div0", "\tdiv0: .asciiz \"runtime error: cannot divide by zero.\"\n", true);
+    Add("nospace", "\tnospace: .asciiz \"runtime error: malloc cannot allocate requested number of bytes\"\n", true);
+    Add("overflow", "\toverflow: .asciiz \"runtime error: arithmetic overflow.\"\n", true);
+    Add("exception", "\texception: .asciiz \"runtime error: exception \"\n", true);
+    Add("outofbounds", "\toutofbounds: .asciiz \"runtime error: index out of bounds.\"\n", true);
+    Add("ferror", FREE_ERRORS, true);
+    Add("mtop", MALLOC_HEADER, true);
+    Add("rtop", "\t.align 2\n\trtop:\t.word 0\t# next free byte of the regions\n\trend:\t.word 0\t# end of the memory of the regions\n", true);
+    Add("optr", PRINT_HEADER, true);
+    Add("odigits", DIGITS_HEADER, true);
+
+    Add("__putc", PUTC_BODY, false, {"optr", "__flush"});
+    Add("__puti", PUTI_BODY, false, {"optr", "odigits", "__flush"});
+    Add("__puts", PUTS_BODY, false, {"optr", "__flush"});
+    Add("__print_array_i32", PRINT_ARRAY_I32_BODY, false, {"__puti", "__putc"});
+    Add("__print_array_bool", PRINT_ARRAY_BOOL_BODY, false, {"__puts", "__putc", "true", "false"});
+    Add("__print_str", PRINT_STR_BODY, false, {"__putc"});
+    Add("__flush", FLUSH_BODY, false, {"optr"});
+    Add("malloc", MALLOC_BODY, false, {"mtop"});
+    if(debug_heap) Add("free", FREE_DEBUG_BODY, false, {"mtop", "ferror", "__flush"});
+    else Add("free", FREE_BODY, false, {"mtop"});
+    Add("__trap", TRAP_BODY, false, {"__flush", "overflow", "exception"});  // last, it goes in .ktext
+}
+
+void Runtime::Add(const std::string& label, const char* text, bool data, std::vector<std::string> uses) {
+    pieces[label] = Piece{text, data, uses};
+    order.push_back(label);
+}
+
+// labels outside the runtime, such as the error handlers of the startup code, are only remembered
+void Runtime::Use(const std::string& label) {
+    if(!used.insert(label).second) return;
+    auto found = pieces.find(label);
+    if(found == pieces.end()) return;
+    for(const std::string& dependency : found->second.uses) Use(dependency);
+}
+
+void Runtime::Scan(const InstrList& list) {
+    for(const Instruction& instr : list.code) {
+        if(instr.op == Op::LABEL || instr.op == Op::COMMENT) continue;
+        for(const Operand* o : {&instr.a, &instr.b, &instr.c}) {
+            if(o->kind == Operand::LABEL) Use(LabelName(o->value));
+        }
+    }
+}
+
+bool Runtime::Uses(const std::string& label) const {
+    return used.count(label);
+}
+
+void Runtime::Emit(Emitter* emitter) const {
+    for(bool data : {true, false}) {
+        bool any = false;
+        for(const std::string& label : order) {
+            const Piece& piece = pieces.at(label);
+            if(piece.data != data || !used.count(label)) continue;
+            if(!any) emitter->line(data ? "\t.data" : "\t.text");
+            any = true;
+            emitter->block(piece.text);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/*
+Runtime.h
+Corbin Weiss
+17 October 2026
+
+Write only the parts of the runtime that a program uses
+*/
+
+/*
+*** Outline of Approach ***
+The runtime is split into pieces: the routines of malloc.h and print.h, and
+the words and strings they and the generated code keep in .data. Each piece is
+known by the label the code refers to it with and lists the pieces it uses
+itself, as __print_array_i32 uses __puti and __putc, which use __flush and
+the output buffer.
+  - once the functions are optimized, every label their instructions refer to
+    is marked, together with the pieces it depends on. Calls that were inlined
+    or proven dead no longer count, since the optimized code is scanned.
+  - the startup code asks which pieces are used before it is generated, so the
+    error handlers, the flush at __exit and the regions are only there when
+    something needs them, and is then scanned like the functions.
+  - at the end the marked pieces are written in a fixed order, the data under
+    .data and the routines under .text. The exception handler comes last, as it
+    switches to .ktext itself.
+A program without arrays, division or output gets no runtime at all.
+*/
+#pragma once
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Emitter.h"
+#include "Instruction.h"
+
+class Runtime {
+    public:
+        explicit Runtime(bool debug_heap);
+        void Use(const std::string& label);     // the code refers to the label
+        void Scan(const InstrList& list);       // use every label the instructions refer to
+        bool Uses(const std::string& label) const;
+        void Emit(Emitter* emitter) const;      // write the used data and routines
+    private:
+        struct Piece {
+            const char* text;
+            bool data;                          // goes in .data instead of .text
+            std::vector<std::string> uses;      // the labels of the pieces it needs
+        };
+        std::map<std::string, Piece> pieces;
+        std::vector<std::string> order;         // the pieces in the order they are written
+        std::set<std::string> used;
+        void Add(const std::string& label, const char* text, bool data, std::vector<std::string> uses = {});
+};
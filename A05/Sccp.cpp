@@ -0,0 +1,286 @@
+/*
+Sccp.cpp
+Corbin Weiss
+17 October 2026
+
+Implement sparse conditional constant propagation over the SSA form of the slots
+*/
+
+#include "Sccp.h"
+#include "Ssa.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+struct Lattice {
+    enum Kind { TOP, CONST, BOTTOM };   // not known yet, a constant, not a constant
+    Kind kind = TOP;
+    int value = 0;
+    bool operator==(const Lattice& other) const { return kind == other.kind && value == other.value; }
+};
+
+static const Lattice BOTTOM = {Lattice::BOTTOM, 0};
+
+static Lattice Const(long value) {
+    if(value < INT_MIN || value > INT_MAX) return BOTTOM;  // the instruction would trap on the overflow
+    return {Lattice::CONST, (int)value};
+}
+
+static Lattice Meet(Lattice a, Lattice b) {
+    if(a.kind == Lattice::TOP) return b;
+    if(b.kind == Lattice::TOP) return a;
+    if(a == b) return a;
+    return BOTTOM;
+}
+
+typedef std::vector<Lattice> RegState;
+
+// the words pushed onto the stack for temporaries since the start of a block
+struct Pushed {
+    int sp = 0;                             // $sp relative to its value at the start of the block
+    std::unordered_map<int, Lattice> words; // relative address -> value
+};
+
+static Lattice ValueOf(const Operand& o, const RegState& regs) {
+    if(o.kind == Operand::IMM) return Const(o.value);
+    if(o.kind == Operand::REG) return regs[o.reg];
+    return BOTTOM;
+}
+
+// the value an instruction computes into its register
+static Lattice Evaluate(const Instruction& instr, const RegState& regs) {
+    if(instr.op == Op::LI) return Const(instr.b.value);
+    if(instr.op == Op::MOVE) return ValueOf(instr.b, regs);
+    Lattice b = ValueOf(instr.b, regs);
+    Lattice c = instr.c.kind == Operand::NONE ? Const(0) : ValueOf(instr.c, regs);
+    switch(instr.op) {
+        case Op::ADD: case Op::ADDI: case Op::SUB: case Op::MUL: case Op::DIV: case Op::REM:
+        case Op::AND: case Op::OR: case Op::NOT: case Op::NEG: case Op::SLL:
+        case Op::SEQ: case Op::SNE: case Op::SLE: case Op::SGE: case Op::SLT: case Op::SGT:
+            break;
+        default:
+            return BOTTOM;  // loads and la
+    }
+    if(b.kind == Lattice::BOTTOM || c.kind == Lattice::BOTTOM) return BOTTOM;
+    if(b.kind == Lattice::TOP || c.kind == Lattice::TOP) return {};
+    long x = b.value, y = c.value;
+    switch(instr.op) {
+        case Op::ADD: case Op::ADDI: return Const(x + y);
+        case Op::SUB: return Const(x - y);
+        case Op::MUL: return Const((int)((unsigned)x * (unsigned)y));  // mul wraps around
+        case Op::DIV: return y == 0 ? BOTTOM : Const(x / y);             // INT_MIN/-1 overflows
+        case Op::REM: return y == 0 || y == -1 ? BOTTOM : Const(x % y);
+        case Op::AND: return Const(x & y);
+        case Op::OR: return Const(x | y);
+        case Op::NOT: return Const(~x);
+        case Op::NEG: return Const(-x);
+        case Op::SLL: return Const((int)((unsigned)x << (y & 31)));
+        case Op::SEQ: return Const(x == y);
+        case Op::SNE: return Const(x != y);
+        case Op::SLE: return Const(x <= y);
+        case Op::SGE: return Const(x >= y);
+        case Op::SLT: return Const(x < y);
+        default: return Const(x > y);
+    }
+}
+
+// whether a branch is taken: a constant 1 or 0, TOP if not known yet, BOTTOM if it can go either way
+static Lattice Condition(const Instruction& instr, const RegState& regs) {
+    Lattice a = ValueOf(instr.a, regs);
+    Lattice b = instr.op == Op::BEQZ || instr.op == Op::BNEZ ? Const(0) : ValueOf(instr.b, regs);
+    if(a.kind == Lattice::BOTTOM || b.kind == Lattice::BOTTOM) return BOTTOM;
+    if(a.kind == Lattice::TOP || b.kind == Lattice::TOP) return {};
+    switch(instr.op) {
+        case Op::BEQ: case Op::BEQZ: return Const(a.value == b.value);
+        case Op::BNE: case Op::BNEZ: return Const(a.value != b.value);
+        case Op::BLT: return Const(a.value < b.value);
+        case Op::BLE: return Const(a.value <= b.value);
+        case Op::BGT: return Const(a.value > b.value);
+        case Op::BGEU: return Const((unsigned)a.value >= (unsigned)b.value);
+        default: return Const(a.value >= b.value);
+    }
+}
+
+class Propagator {
+    public:
+        Propagator(InstrList& list) : list(list), cfg(list), ssa(list, cfg) {}
+        void Run();
+        void Rewrite();
+    private:
+        InstrList& list;
+        Cfg cfg;
+        Ssa ssa;
+        std::vector<Lattice> values;                // lattice value of each SSA value
+        std::vector<bool> executable;               // blocks
+        std::vector<std::vector<bool>> edges;       // executable incoming edges of each block, in the order of preds
+        std::vector<RegState> out;                  // registers at the end of each block
+        bool changed = false;
+
+        RegState Entry(int b) const;
+        void Step(int i, RegState& regs, Pushed& pushed);
+        void Visit(int b);
+        void MarkEdge(int from, int to);
+};
+
+// the registers on entry to a block
+RegState Propagator::Entry(int b) const {
+    if(b == 0) {
+        RegState regs(NUM_REGS, BOTTOM);
+        regs[ZERO] = Const(0);
+        return regs;
+    }
+    RegState regs(NUM_REGS);
+    const std::vector<int>& preds = cfg.blocks[b].preds;
+    for(int k = 0; k < (int)preds.size(); k++) {
+        if(!edges[b][k]) continue;
+        for(int r = 0; r < NUM_REGS; r++) regs[r] = Meet(regs[r], out[preds[k]][r]);
+    }
+    return regs;
+}
+
+// evaluate one instruction, lowering the values stored to slots
+void Propagator::Step(int i, RegState& regs, Pushed& pushed) {
+    const Instruction& instr = list.code[i];
+    int v = ssa.value_of[i];
+    if(instr.op == Op::ADDI && instr.a.reg == SP && instr.b.reg == SP) {
+        pushed.sp += instr.c.value;
+    }
+    else if(instr.op == Op::SW && instr.b.reg == SP) {
+        pushed.words[pushed.sp + instr.b.value] = regs[instr.a.reg];
+    }
+    else if(instr.op == Op::LW && instr.b.reg == SP) {
+        auto found = pushed.words.find(pushed.sp + instr.b.value);
+        regs[instr.a.reg] = found == pushed.words.end() ? BOTTOM : found->second;
+    }
+    else if(ssa.slot_of[i] >= 0 && instr.op == Op::SW) {
+        Lattice lowered = Meet(values[v], regs[instr.a.reg]);
+        if(!(lowered == values[v])) {
+            values[v] = lowered;
+            changed = true;
+        }
+    }
+    else if(ssa.slot_of[i] >= 0) {
+        regs[instr.a.reg] = v < 0 ? BOTTOM : values[v];
+    }
+    else if(instr.op == Op::SW) {
+        pushed.words.clear();   // a store through a pointer
+    }
+    else if(instr.op == Op::JAL) {
+        pushed.words.clear();
+        // the callee and the runtime only preserve the $s registers and the stack
+        for(int r = 0; r < NUM_REGS; r++) {
+            if(r != ZERO && r != SP && r != FP && (r < S0 || r > S7)) regs[r] = BOTTOM;
+        }
+    }
+    else if(instr.op == Op::SYSCALL) {
+        regs[V0] = BOTTOM;
+    }
+    else if(DefReg(instr) > 0) {
+        if(DefReg(instr) == SP) pushed.words.clear();
+        regs[DefReg(instr)] = Evaluate(instr, regs);
+    }
+}
+
+void Propagator::MarkEdge(int from, int to) {
+    const std::vector<int>& preds = cfg.blocks[to].preds;
+    int k = std::find(preds.begin(), preds.end(), from) - preds.begin();
+    if(edges[to][k]) return;
+    edges[to][k] = true;
+    executable[to] = true;
+    changed = true;
+}
+
+void Propagator::Visit(int b) {
+    const BasicBlock& block = cfg.blocks[b];
+    for(const Phi& phi : ssa.phis) {
+        if(phi.block != b) continue;
+        Lattice joined;
+        for(int k = 0; k < (int)phi.args.size(); k++) {
+            if(edges[b][k]) joined = Meet(joined, phi.args[k] < 0 ? BOTTOM : values[phi.args[k]]);
+        }
+        joined = Meet(values[phi.value], joined);
+        if(!(joined == values[phi.value])) {
+            values[phi.value] = joined;
+            changed = true;
+        }
+    }
+    RegState regs = Entry(b);
+    Pushed pushed;
+    for(int i = block.begin; i < block.end; i++) Step(i, regs, pushed);
+    if(!(regs == out[b])) {
+        out[b] = regs;
+        changed = true;
+    }
+
+    // the successors that can be reached with these values
+    if(block.begin == block.end) return;
+    const Instruction& last = list.code[block.end - 1];
+    int target = BranchTarget(last, cfg.labels);
+    bool taken = last.op == Op::J, falls_through = last.op != Op::J && last.op != Op::JR;
+    if(IsBranch(last.op)) {
+        Lattice cond = Condition(last, regs);
+        taken = cond.kind == Lattice::BOTTOM || (cond.kind == Lattice::CONST && cond.value);
+        falls_through = cond.kind == Lattice::BOTTOM || (cond.kind == Lattice::CONST && !cond.value);
+    }
+    if(taken && target >= 0) MarkEdge(b, cfg.block_of[target]);
+    if(falls_through && b + 1 < (int)cfg.blocks.size()) MarkEdge(b, b + 1);
+}
+
+void Propagator::Run() {
+    int nblocks = cfg.blocks.size();
+    values.assign(ssa.values.size(), {});
+    for(int s = 0; s < ssa.NumSlots(); s++) values[s] = BOTTOM;    // whatever the slot held on entry
+    executable.assign(nblocks, false);
+    executable[0] = true;
+    edges.resize(nblocks);
+    for(int b = 0; b < nblocks; b++) edges[b].assign(cfg.blocks[b].preds.size(), false);
+    out.assign(nblocks, RegState(NUM_REGS));
+    do {
+        changed = false;
+        for(int b : cfg.order) {
+            if(executable[b]) Visit(b);
+        }
+    } while(changed);
+}
+
+void Propagator::Rewrite() {
+    std::vector<Instruction>& code = list.code;
+    for(int b = 0; b < (int)cfg.blocks.size(); b++) {
+        const BasicBlock& block = cfg.blocks[b];
+        if(!executable[b]) {
+            // never reached: the block goes, and with it its label
+            for(int i = block.begin; i < block.end; i++) code[i] = Instruction(Op::COMMENT);
+            continue;
+        }
+        RegState regs = Entry(b);
+        Pushed pushed;
+        for(int i = block.begin; i < block.end; i++) {
+            Instruction& instr = code[i];
+            if(IsBranch(instr.op)) {
+                Lattice cond = Condition(instr, regs);
+                if(cond.kind != Lattice::CONST) continue;
+                const Operand& target = instr.c.kind == Operand::LABEL ? instr.c : instr.b;
+                instr = cond.value ? Instruction(Op::J, target, Operand(), Operand(), instr.comment)
+                                   : Instruction(Op::COMMENT);
+                continue;
+            }
+            bool is_load = instr.op == Op::LW && ssa.slot_of[i] >= 0;
+            Step(i, regs, pushed);
+            int reg = DefReg(instr);
+            if(reg <= 0 || instr.op == Op::LI || instr.op == Op::JAL || instr.op == Op::SYSCALL) continue;
+            if(regs[reg].kind != Lattice::CONST) continue;
+            // pops are left for the peephole optimizer, which removes them with their push
+            if(!is_load && (instr.op == Op::LW || instr.op == Op::LA)) continue;
+            instr = Instruction(Op::LI, instr.a, Imm(regs[reg].value), Operand(), instr.comment);
+        }
+    }
+    // drop the removed instructions, none of which are part of the prologue
+    code.erase(std::remove_if(code.begin(), code.end(),
+        [](const Instruction& instr) { return instr.op == Op::COMMENT && instr.comment.empty(); }), code.end());
+}
+
+void PropagateConstants(InstrList& list) {
+    Propagator propagator(list);
+    propagator.Run();
+    propagator.Rewrite();
+}
@@ -0,0 +1,29 @@
+/*
+Sccp.h
+Corbin Weiss
+17 October 2026
+
+Sparse conditional constant propagation over the instruction list of a function
+*/
+
+/*
+*** Outline of Approach ***
+Every SSA value of a local variable slot and every register gets a lattice
+value: not known yet, a constant, or not a constant. Starting with only the
+entry block executable, the blocks are evaluated in reverse postorder:
+  - a phi node is the meet of its arguments on the executable incoming edges
+  - a load of a slot gets the lattice value of the SSA value it reads, a store
+    lowers the lattice value of the SSA value it defines
+  - the registers on entry to a block are the meet of the registers at the end
+    of its executable predecessors, and the instructions are evaluated in order
+  - a branch on a constant only makes the edge it takes executable
+This is repeated until nothing changes. Then blocks that never became executable
+are removed together with their labels, branches on constants become jumps or
+disappear, and loads and operations that always produce the same constant are
+replaced by li. Operations that would trap at runtime, such as an overflowing
+add or a division by zero, are never treated as constants.
+*/
+#pragma once
+#include "Instruction.h"
+
+void PropagateConstants(InstrList& list);
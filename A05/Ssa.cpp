@@ -0,0 +1,173 @@
+/*
+Ssa.cpp
+Corbin Weiss
+17 October 2026
+
+Implement phi placement and renaming of the local variable slots
+*/
+
+#include "Ssa.h"
+#include <algorithm>
+#include <numeric>
+
+bool IsSlotAccess(const Instruction& instr) {
+    return (instr.op == Op::LW || instr.op == Op::SW) && instr.b.kind == Operand::MEM
+        && instr.b.reg == FP && instr.b.value <= 0;
+}
+
+Ssa::Ssa(const InstrList& list, const Cfg& cfg) {
+    const std::vector<Instruction>& code = list.code;
+    int n = code.size();
+    std::unordered_map<int, int> slot_ids;     // frame offset -> slot
+    slot_of.assign(n, -1);
+    value_of.assign(n, -1);
+    for(int i = 0; i < n; i++) {
+        if(!IsSlotAccess(code[i])) continue;
+        auto found = slot_ids.find(code[i].b.value);
+        if(found == slot_ids.end()) {
+            found = slot_ids.emplace(code[i].b.value, offsets.size()).first;
+            offsets.push_back(code[i].b.value);
+        }
+        slot_of[i] = found->second;
+    }
+    for(int s = 0; s < NumSlots(); s++) values.push_back({s});
+    PlacePhis(list, cfg, LiveIn(list, cfg));
+    Rename(list, cfg);
+}
+
+// the slots that are live on entry to each block
+std::vector<std::vector<bool>> Ssa::LiveIn(const InstrList& list, const Cfg& cfg) const {
+    int nblocks = cfg.blocks.size();
+    std::vector<std::vector<bool>> uses(nblocks, std::vector<bool>(NumSlots(), false));
+    std::vector<std::vector<bool>> defs = uses;
+    for(int b = 0; b < nblocks; b++) {
+        for(int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            int s = slot_of[i];
+            if(s < 0) continue;
+            if(list.code[i].op == Op::LW && !defs[b][s]) uses[b][s] = true;
+            if(list.code[i].op == Op::SW) defs[b][s] = true;
+        }
+    }
+    std::vector<std::vector<bool>> live_in = uses;
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        for(auto b = cfg.order.rbegin(); b != cfg.order.rend(); ++b) {
+            for(int succ : cfg.blocks[*b].succs) {
+                for(int s = 0; s < NumSlots(); s++) {
+                    if(live_in[succ][s] && !defs[*b][s] && !live_in[*b][s]) {
+                        live_in[*b][s] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    return live_in;
+}
+
+void Ssa::PlacePhis(const InstrList& list, const Cfg& cfg, const std::vector<std::vector<bool>>& live_in) {
+    std::vector<std::vector<int>> frontiers = cfg.DominanceFrontiers();
+    std::vector<std::vector<int>> def_blocks(NumSlots());
+    for(int i = 0; i < (int)slot_of.size(); i++) {
+        if(slot_of[i] >= 0 && list.code[i].op == Op::SW && cfg.Reachable(cfg.block_of[i])) {
+            std::vector<int>& blocks = def_blocks[slot_of[i]];
+            if(blocks.empty() || blocks.back() != cfg.block_of[i]) blocks.push_back(cfg.block_of[i]);
+        }
+    }
+    for(int s = 0; s < NumSlots(); s++) {
+        std::vector<bool> has_phi(cfg.blocks.size(), false);
+        std::vector<int> work = def_blocks[s];
+        while(!work.empty()) {
+            int b = work.back();
+            work.pop_back();
+            for(int join : frontiers[b]) {
+                if(has_phi[join] || !live_in[join][s]) continue;
+                has_phi[join] = true;
+                values.push_back({s, -1, (int)phis.size()});
+                phis.push_back({join, s, (int)values.size() - 1,
+                                std::vector<int>(cfg.blocks[join].preds.size(), -1)});
+                work.push_back(join);   // the phi is a new definition of the slot
+            }
+        }
+    }
+}
+
+void Ssa::Rename(const InstrList& list, const Cfg& cfg) {
+    std::vector<std::vector<int>> phis_of(cfg.blocks.size());
+    for(int p = 0; p < (int)phis.size(); p++) phis_of[phis[p].block].push_back(p);
+    std::vector<std::vector<int>> children = cfg.DominatorTree();
+
+    // the current value of each slot, starting with its value on entry
+    std::vector<std::vector<int>> current(NumSlots());
+    for(int s = 0; s < NumSlots(); s++) current[s].push_back(s);
+    std::vector<int> pushed;    // the slots whose value was pushed, to undo when a subtree is done
+
+    struct Frame { int block; int child; size_t pushed; };
+    std::vector<Frame> stack = {{0, -1, 0}};
+    while(!stack.empty()) {
+        Frame& frame = stack.back();
+        const BasicBlock& block = cfg.blocks[frame.block];
+        if(frame.child < 0) {
+            // first visit: define the values of the block
+            for(int p : phis_of[frame.block]) {
+                current[phis[p].slot].push_back(phis[p].value);
+                pushed.push_back(phis[p].slot);
+            }
+            for(int i = block.begin; i < block.end; i++) {
+                int s = slot_of[i];
+                if(s < 0) continue;
+                if(list.code[i].op == Op::LW) {
+                    value_of[i] = current[s].back();
+                }
+                else {
+                    values.push_back({s, i});
+                    value_of[i] = values.size() - 1;
+                    current[s].push_back(value_of[i]);
+                    pushed.push_back(s);
+                }
+            }
+            for(int succ : block.succs) {
+                const std::vector<int>& preds = cfg.blocks[succ].preds;
+                int k = std::find(preds.begin(), preds.end(), frame.block) - preds.begin();
+                for(int p : phis_of[succ]) phis[p].args[k] = current[phis[p].slot].back();
+            }
+            frame.child = 0;
+        }
+        if(frame.child < (int)children[frame.block].size()) {
+            int child = children[frame.block][frame.child++];
+            stack.push_back({child, -1, pushed.size()});
+            continue;
+        }
+        // leaving the subtree: restore the values of its parent
+        while(pushed.size() > frame.pushed) {
+            current[pushed.back()].pop_back();
+            pushed.pop_back();
+        }
+        stack.pop_back();
+    }
+}
+
+std::vector<int> Ssa::Webs() const {
+    // union the values of every phi with its arguments
+    std::vector<int> parent(values.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&](int v) {
+        while(parent[v] != v) v = parent[v] = parent[parent[v]];
+        return v;
+    };
+    for(const Phi& phi : phis) {
+        for(int arg : phi.args) {
+            if(arg >= 0) parent[find(arg)] = find(phi.value);
+        }
+    }
+    std::vector<int> web(values.size(), -1);
+    std::vector<int> number(values.size(), -1);
+    int count = 0;
+    for(int v = 0; v < (int)values.size(); v++) {
+        int root = find(v);
+        if(number[root] < 0) number[root] = count++;
+        web[v] = number[root];
+    }
+    return web;
+}
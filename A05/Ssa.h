@@ -0,0 +1,61 @@
+/*
+Ssa.h
+Corbin Weiss
+17 October 2026
+
+Static single assignment form of the local variable slots of a function
+*/
+
+/*
+*** Outline of Approach ***
+The local variables and parameters of a function live in slots at fixed offsets
+below $fp. They are only ever read and written with lw/sw off($fp) and their
+address is never taken, so each slot can be treated as a variable and put into
+SSA form, which is what mem2reg does for the allocas of other compilers:
+  - every store to a slot defines a new value, every load uses the value that
+    reaches it
+  - phi nodes are placed on the iterated dominance frontier of the blocks that
+    store to the slot, but only where the slot is live (pruned SSA). These are
+    the joins after an if and the headers of the while loops.
+  - the values are numbered by walking the dominator tree with a stack of the
+    current value of each slot
+The values that are joined by phi nodes form a web. Two webs of one slot are
+never live at the same time, because they all came from the same memory word,
+so SSA is taken apart again by giving each web its own register or leaving it
+in the slot, and the copies of the phi nodes all become the same register.
+*/
+#pragma once
+#include "Cfg.h"
+
+struct SsaValue {
+    int slot;
+    int def = -1;       // the instruction storing the value, -1 for a phi or the value on entry
+    int phi = -1;       // the phi node defining the value, or -1
+};
+
+struct Phi {
+    int block;
+    int slot;
+    int value;              // the value the phi defines
+    std::vector<int> args;  // the value coming in from each predecessor, in the order of preds
+};
+
+class Ssa {
+    public:
+        std::vector<int> offsets;       // the frame offset of each slot
+        std::vector<int> slot_of;       // the slot each instruction loads or stores, -1 if none
+        std::vector<SsaValue> values;   // the first values are the values of the slots on entry
+        std::vector<Phi> phis;
+        std::vector<int> value_of;      // the value stored or loaded by each instruction, -1 if none or unreachable
+
+        Ssa(const InstrList& list, const Cfg& cfg);
+        std::vector<int> Webs() const;  // the web of each value, numbered from 0
+        int NumSlots() const { return offsets.size(); }
+    private:
+        std::vector<std::vector<bool>> LiveIn(const InstrList& list, const Cfg& cfg) const;
+        void PlacePhis(const InstrList& list, const Cfg& cfg, const std::vector<std::vector<bool>>& live_in);
+        void Rename(const InstrList& list, const Cfg& cfg);
+};
+
+// a load or store of a local variable slot
+bool IsSlotAccess(const Instruction& instr);
@@ -0,0 +1,265 @@
+/*
+Strength.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the pointers that replace the array addresses computed from induction variables
+*/
+
+#include "Strength.h"
+#include "Cfg.h"
+#include "Ssa.h"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+
+// a register holding the value of a slot, loaded in the same block, plus a constant
+struct Affine {
+    enum Kind { NONE, CONST, SLOT };
+    Kind kind = NONE;
+    int slot = 0;       // the frame offset of the slot
+    int offset = 0;     // the constant, or the value of a constant
+};
+
+static Affine Plus(Affine value, long c) {
+    long sum = value.offset + c;
+    if(value.kind == Affine::NONE || sum < -(1 << 15) || sum >= (1 << 15)) return {};
+    value.offset = sum;
+    return value;
+}
+
+// an address (index << 2) + array with index = slot + offset
+struct Use {
+    int instr;      // the shift, followed by the add
+    int slot;
+    int array;      // the frame offset of the array pointer
+    int offset;
+};
+
+class Reducer {
+    public:
+        Reducer(InstrList& list, const Cfg& cfg, const Loop& loop) : list(list), cfg(cfg), loop(loop) {}
+        void Run();
+    private:
+        InstrList& list;
+        const Cfg& cfg;
+        const Loop& loop;
+        std::set<int> stored;                       // offsets of the slots stored in the loop
+        std::map<int, std::vector<std::pair<int, int>>> steps;  // slot -> (store, step) of each store to it
+        std::set<int> not_induction;                // slots stored with something else than a step
+        std::vector<Use> uses;
+
+        bool Continues(int b) const;
+        void Simulate(int b);
+        bool DeadAfter(int i, int reg) const;
+};
+
+// the register is written again before anything reads it
+bool Reducer::DeadAfter(int i, int reg) const {
+    const std::vector<Instruction>& code = list.code;
+    auto scan = [&](int from, int to) {
+        for(int j = from; j < to; j++) {
+            if(UsesReg(code[j], reg)) return 0;
+            if(DefReg(code[j]) == reg) return 1;
+        }
+        return -1;  // not decided in this block
+    };
+    int b = cfg.block_of[i];
+    int found = scan(i + 1, cfg.blocks[b].end);
+    if(found >= 0) return found;
+    for(int succ : cfg.blocks[b].succs) {
+        if(scan(cfg.blocks[succ].begin, cfg.blocks[succ].end) != 1) return false;
+    }
+    return true;
+}
+
+// the block of the loop is only entered past a bounds check or another branch out of the function
+bool Reducer::Continues(int b) const {
+    const BasicBlock& block = cfg.blocks[b];
+    if(block.preds.size() != 1 || block.preds[0] != b - 1 || !cfg.InLoop(b, &loop - cfg.loops.data())) return false;
+    const Instruction& last = list.code[cfg.blocks[b - 1].end - 1];
+    return IsBranch(last.op) && BranchTarget(last, cfg.labels) < 0;
+}
+
+// follow the slot values through the registers and the pushed words of a block and the blocks it continues into
+void Reducer::Simulate(int b) {
+    const std::vector<Instruction>& code = list.code;
+    std::vector<Affine> regs(NUM_REGS);
+    regs[ZERO] = {Affine::CONST, 0, 0};
+    int sp = 0;
+    std::unordered_map<int, Affine> pushed;     // relative address -> value
+    std::unordered_map<int, Affine> held;       // slot -> value stored to it in the block, for the expression temporaries
+    int end = cfg.blocks[b].end;
+    while(end < (int)code.size() && Continues(cfg.block_of[end])) end = cfg.blocks[cfg.block_of[end]].end;
+    for(int i = cfg.blocks[b].begin; i < end; i++) {
+        const Instruction& instr = code[i];
+        if(instr.op == Op::ADDI && instr.a.reg == SP && instr.b.reg == SP) {
+            sp += instr.c.value;
+            continue;
+        }
+        if(instr.op == Op::SW && instr.b.reg == SP) {
+            pushed[sp + instr.b.value] = regs[instr.a.reg];
+            continue;
+        }
+        if(instr.op == Op::LW && instr.b.reg == SP) {
+            auto found = pushed.find(sp + instr.b.value);
+            regs[instr.a.reg] = found == pushed.end() ? Affine() : found->second;
+            continue;
+        }
+        if(IsSlotAccess(instr) && instr.op == Op::SW) {
+            int slot = instr.b.value;
+            const Affine& value = regs[instr.a.reg];
+            if(value.kind == Affine::SLOT && value.slot == slot && DeadAfter(i, instr.a.reg)) {
+                steps[slot].push_back({i, value.offset});
+            }
+            else {
+                not_induction.insert(slot);
+            }
+            Affine stored = value.kind == Affine::SLOT && value.slot == slot ? Affine() : value;
+            // the registers loaded from the slot hold its old value now
+            for(Affine& reg : regs) {
+                if(reg.kind == Affine::SLOT && reg.slot == slot) reg = Affine();
+            }
+            for(auto& [address, word] : pushed) {
+                if(word.kind == Affine::SLOT && word.slot == slot) word = Affine();
+            }
+            for(auto& [other, word] : held) {
+                if(word.kind == Affine::SLOT && word.slot == slot) word = Affine();
+            }
+            held[slot] = stored;
+            continue;
+        }
+        if(instr.op == Op::SW || instr.op == Op::JAL) {
+            pushed.clear();
+            if(instr.op == Op::JAL) std::fill(regs.begin() + 1, regs.end(), Affine());
+            continue;
+        }
+        if(instr.op == Op::SLL && instr.c.kind == Operand::IMM && instr.c.value == 2 && i + 1 < end) {
+            const Affine& index = regs[instr.b.reg];
+            const Instruction& next = code[i + 1];
+            if(index.kind == Affine::SLOT && next.op == Op::ADD && next.a.reg == instr.a.reg
+               && next.b.reg == instr.a.reg && next.c.kind == Operand::REG && next.c.reg != instr.a.reg) {
+                const Affine& array = regs[next.c.reg];
+                if(array.kind == Affine::SLOT && array.offset == 0) uses.push_back({i, index.slot, array.slot, index.offset});
+            }
+        }
+        int def = DefReg(instr);
+        if(def <= 0) continue;
+        if(def == SP) pushed.clear();
+        Affine result;
+        switch(instr.op) {
+            case Op::LI:
+                result = {Affine::CONST, 0, instr.b.value};
+                break;
+            case Op::MOVE:
+                result = regs[instr.b.reg];
+                break;
+            case Op::LW:
+                if(IsSlotAccess(instr)) {
+                    auto found = held.find(instr.b.value);
+                    result = found != held.end() && found->second.kind != Affine::NONE ? found->second
+                        : Affine{Affine::SLOT, instr.b.value, 0};
+                }
+                break;
+            case Op::ADDI:
+                result = Plus(regs[instr.b.reg], instr.c.value);
+                break;
+            case Op::ADD:
+            case Op::SUB: {
+                Affine l = regs[instr.b.reg];
+                Affine r = instr.c.kind == Operand::IMM ? Affine{Affine::CONST, 0, instr.c.value} : regs[instr.c.reg];
+                int sign = instr.op == Op::ADD ? 1 : -1;
+                if(r.kind == Affine::CONST) result = Plus(l, sign * (long)r.offset);
+                else if(l.kind == Affine::CONST && instr.op == Op::ADD) result = Plus(r, l.offset);
+                break;
+            }
+            default:
+                break;
+        }
+        regs[def] = result;
+    }
+}
+
+void Reducer::Run() {
+    std::vector<Instruction>& code = list.code;
+    if(!cfg.HasPreheader(loop, code)) return;
+    for(int b : loop.blocks) {
+        for(int i = cfg.blocks[b].begin; i < cfg.blocks[b].end; i++) {
+            if(IsSlotAccess(code[i]) && code[i].op == Op::SW) stored.insert(code[i].b.value);
+        }
+    }
+    for(int b : loop.blocks) {
+        if(!Continues(b)) Simulate(b);
+    }
+
+    // one pointer for every pair of induction variable and array
+    std::map<std::pair<int, int>, Operand> pointers;
+    std::vector<Instruction> preheader = {Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### Induction Pointers ###")};
+    std::unordered_map<int, Instruction> replaced;
+    for(const Use& use : uses) {
+        if(!steps.count(use.slot) || not_induction.count(use.slot) || stored.count(use.array)) continue;
+        Operand& pointer = pointers[{use.slot, use.array}];
+        if(pointer.kind == Operand::NONE) {
+            pointer = list.NewSlot();
+            preheader.push_back(Instruction(Op::LW, T0, Mem(use.slot, FP), Operand(), "get the induction variable"));
+            preheader.push_back(Instruction(Op::SLL, T0, T0, Imm(2), "multiply it by 4 to get byte size"));
+            preheader.push_back(Instruction(Op::LW, T1, Mem(use.array, FP), Operand(), "get the address of the array"));
+            preheader.push_back(Instruction(Op::ADDU, T0, T0, T1, "point into the array"));
+            preheader.push_back(Instruction(Op::SW, T0, pointer, Operand(), "save the pointer"));
+        }
+        Register reg = (Register)code[use.instr].a.reg;
+        replaced.insert({use.instr, Instruction(Op::LW, reg, pointer, Operand(), "get the pointer into the array")});
+        replaced.insert({use.instr + 1, use.offset == 0 ? Instruction(Op::COMMENT)
+            : Instruction(Op::ADDIU, reg, reg, Imm(4 * use.offset), "move it to the element")});
+    }
+    if(pointers.empty()) return;
+
+    // every step of a variable moves its pointers along
+    std::unordered_map<int, std::vector<Instruction>> after;
+    for(const auto& [key, pointer] : pointers) {
+        for(auto [store, step] : steps[key.first]) {
+            if(step == 0) continue;
+            Register reg = (Register)code[store].a.reg;
+            std::vector<Instruction>& moves = after[store];
+            moves.push_back(Instruction(Op::LW, reg, pointer, Operand(), "get the pointer into the array"));
+            moves.push_back(Instruction(Op::ADDIU, reg, reg, Imm(4 * step), "move it along with the index"));
+            moves.push_back(Instruction(Op::SW, reg, pointer, Operand(), "save the pointer"));
+        }
+    }
+    std::vector<Instruction> reduced;
+    int header = cfg.blocks[loop.header].begin;
+    for(int i = 0; i < (int)code.size(); i++) {
+        if(i == header) reduced.insert(reduced.end(), preheader.begin(), preheader.end());
+        auto found = replaced.find(i);
+        reduced.push_back(found == replaced.end() ? code[i] : found->second);
+        auto moves = after.find(i);
+        if(moves != after.end()) reduced.insert(reduced.end(), moves->second.begin(), moves->second.end());
+    }
+    code.swap(reduced);
+}
+
+void ReduceStrength(InstrList& list) {
+    // the labels of the loop headers
+    std::vector<int> headers;
+    {
+        Cfg cfg(list);
+        for(const Loop& loop : cfg.loops) {
+            const Instruction& first = list.code[cfg.blocks[loop.header].begin];
+            if(first.op == Op::LABEL) headers.push_back(first.a.value);
+        }
+    }
+    // the pointers add instructions, so the graph is built again for every loop
+    for(int label : headers) {
+        Cfg cfg(list);
+        for(const Loop& loop : cfg.loops) {
+            const BasicBlock& header = cfg.blocks[loop.header];
+            if(list.code[header.begin].op == Op::LABEL && list.code[header.begin].a.value == label) {
+                Reducer(list, cfg, loop).Run();
+                break;
+            }
+        }
+    }
+    list.code.erase(std::remove_if(list.code.begin(), list.code.end(),
+        [](const Instruction& instr) { return instr.op == Op::COMMENT && instr.comment.empty(); }), list.code.end());
+}
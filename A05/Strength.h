@@ -0,0 +1,33 @@
+/*
+Strength.h
+Corbin Weiss
+17 October 2026
+
+Strength reduction of the array addresses computed from induction variables
+*/
+
+/*
+*** Outline of Approach ***
+An array access computes the address of its element as (index << 2) + array on
+every iteration of a loop, although the index of a scanning loop only moves by a
+constant step. The pass works on the instruction list before the locals are
+allocated, one while loop at a time:
+  - a slot is an induction variable of the loop when every store to it in the
+    loop stores the value it held plus a constant, as i += 1 and pos -= 1 do
+  - an address is reduced when the shifted value is an induction variable plus
+    a constant, and the array pointer it is added to is a slot the loop does not
+    store
+  - each pair of induction variable and array gets a pointer in a new slot of
+    the frame, set to array + 4 * variable in a preheader before the label of
+    the loop header. Right after every store to the variable the pointer moves
+    by 4 times the step, so the two always agree.
+  - the shift and the add become a load of the pointer, which the register
+    allocator keeps in an $s register, plus the constant of the index times 4
+The pointer is computed and moved with addu and addiu, which do not trap on
+overflow, since the variable may leave the range of the array once the loop is
+done with it.
+*/
+#pragma once
+#include "Instruction.h"
+
+void ReduceStrength(InstrList& list);
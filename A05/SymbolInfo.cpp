@@ -67,6 +67,40 @@ TypeInfo SymbolInfo::getReturnType() {
 SymbolInfo::SymbolInfo(TypeInfo t, bool local)
 : return_type(t), local(local) {}
 
+/*
+    An array passed to a function is kept by it when the parameter
+    escapes there, or is passed on to a parameter that keeps it.
+    Parameters that are lent to each other in a cycle do not keep
+    the array unless one of them escapes.
+*/
+bool SymbolInfo::Kept() {
+    std::set<SymbolInfo*> seen;
+    return Kept(seen);
+}
+
+bool SymbolInfo::Kept(std::set<SymbolInfo*>& seen) {
+    if(escapes) return true;
+    if(!seen.insert(this).second) return false;
+    for(auto& [func, param] : lent) {
+        if(func->GetParam(param)->Kept(seen)) return true;
+    }
+    return false;
+}
+
+/*
+    Being assigned a new array only moves the pointer of the variable, but
+    an array that was assigned to another variable or returned, or that
+    is passed to a call which keeps it, may still be used through them.
+*/
+bool SymbolInfo::Shared() {
+    if(shared) return true;
+    std::set<SymbolInfo*> seen = {this};
+    for(auto& [func, param] : lent) {
+        if(func->GetParam(param)->Kept(seen)) return true;
+    }
+    return false;
+}
+
 // **************************
 
 std::string IdentifierInfo::show() {
@@ -8,6 +8,7 @@ Define the abstract SymbolInfo data structure and its children FunctionInfo and
 
 #include <string>
 #include <vector>
+#include <set>
 #define UNKNOWN_ARR INT_MAX
 
 enum TypeError {
@@ -48,6 +49,8 @@ using Literal = std::variant<int, bool>;
 std::string typeToString(TypeInfo t);
 std::string typeToString(std::vector<TypeInfo> types);
 
+class FunctionInfo;
+
 /*
 Abstract base class defining structure of SymbolTable entry
 */
@@ -55,7 +58,13 @@ class SymbolInfo {
     private:
         TypeInfo return_type = TypeInfo(Type::none);
         int stack_offset = 0;
-        bool local; // if local, need to free arrays.
+        bool local = false; // if local, need to free arrays.
+        bool escapes = false;   // the pointer of the array is returned or assigned
+        bool shared = false;    // another variable or a caller may point to the same array
+        std::vector<std::pair<FunctionInfo*, int>> lent;    // the functions and parameters the array is passed to
+        bool on_stack = false;  // the array lives in the frame of its function and is not freed
+        bool in_region = false; // the array lives in the region of the activation and is not freed
+        bool Kept(std::set<SymbolInfo*>& seen);
     public:
         SymbolInfo(TypeInfo returnType);
         SymbolInfo(TypeInfo returnType, bool local);
@@ -64,6 +73,16 @@ class SymbolInfo {
         int GetOffset() { return stack_offset; }
         void SetOffset(int value) { stack_offset = value; }
         bool IsLocal() { return local; }
+        void Escape() { escapes = shared = true; }
+        void Replace() { escapes = true; }  // the variable is assigned an array nothing else points to
+        bool Escapes() { return escapes || !lent.empty(); }
+        void Lend(FunctionInfo* func, int param) { lent.push_back({func, param}); }
+        bool Kept();    // the array may outlive the call it is lent to, or be freed by it
+        bool Shared();  // the array may be used through another variable once it is replaced
+        void KeepOnStack() { on_stack = true; }
+        bool IsOnStack() { return on_stack; }
+        void KeepInRegion() { in_region = true; }
+        bool IsInRegion() { return in_region; }
 };
 
 class IdentifierInfo : public SymbolInfo {
@@ -80,11 +99,14 @@ class IdentifierInfo : public SymbolInfo {
 class FunctionInfo : public SymbolInfo {
     private:
         std::vector<TypeInfo> param_list;
+        std::vector<SymbolInfo*> params;    // the parameters in the local symbol table of the function
     public:
         FunctionInfo(TypeInfo returnType, std::vector<TypeInfo> paramTypes);
         // check for type mismatch between function signature and arguments
         // Return ArgNumber, ArgType, or None
         std::vector<TypeInfo> getParamList();
+        void SetParams(std::vector<SymbolInfo*> infos) { params = infos; }
+        SymbolInfo* GetParam(int i) { return params[i]; }
         std::string show();
         
 };
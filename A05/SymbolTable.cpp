@@ -51,7 +51,7 @@ std::vector<SymbolInfo*> SymbolTable::FindLocalArrays() {
     for(auto it = this->symbols.begin(); it != this->symbols.end(); ++it){
         Type t = it->second->getReturnType().type;
         if(t == Type::array_bool || t == Type::array_i32) {
-            if(it->second->IsLocal()) {
+            if(it->second->IsLocal() && !it->second->IsOnStack() && !it->second->IsInRegion()) {
                 result.push_back(it->second);
             }
         }
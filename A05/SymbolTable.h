@@ -41,7 +41,8 @@ class SymbolTable {
         */
         void show();
         /*
-            Return all SymbolInfo entries with the given type. Used for freeing arrays
+            Return all SymbolInfo entries with the given type. Used for freeing arrays,
+            so the arrays kept in the frame are left out
         */
         std::vector<SymbolInfo*> FindLocalArrays();
 };
@@ -0,0 +1,149 @@
+/*
+Tail.cpp
+Corbin Weiss
+17 October 2026
+
+Implement the detection of calls in tail position and their rewriting into jumps
+*/
+
+#include "Tail.h"
+#include "Ssa.h"
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+Operand TailReturnLabel(const std::string& name) {
+    return Lbl("_tailreturn_" + name);
+}
+
+class TailCalls {
+    public:
+        explicit TailCalls(std::vector<InstrList*>& functions);
+        void Rewrite(InstrList& list);
+    private:
+        std::vector<InstrList*>& functions;
+        std::unordered_map<int, int> index;     // label id of a function -> its index
+
+        int Callee(const Instruction& instr) const;
+        bool InTailPosition(const InstrList& list, int call) const;
+};
+
+TailCalls::TailCalls(std::vector<InstrList*>& functions) : functions(functions) {
+    for(int f = 0; f < (int)functions.size(); f++) index[Lbl("__" + functions[f]->name).value] = f;
+}
+
+// the function a jal goes to, or -1 for the runtime
+int TailCalls::Callee(const Instruction& instr) const {
+    if(instr.op != Op::JAL) return -1;
+    auto found = index.find(instr.a.value);
+    return found == index.end() ? -1 : found->second;
+}
+
+// only the value the call left in $v0 is moved around until the end of the function
+bool TailCalls::InTailPosition(const InstrList& list, int call) const {
+    const std::vector<Instruction>& code = list.code;
+    std::vector<bool> result(NUM_REGS, false);  // registers holding the value of the call
+    result[V0] = true;
+    int sp = 0;                                 // $sp relative to its value at the call
+    std::unordered_map<int, bool> words;        // relative address -> holds the value of the call
+    std::unordered_map<int, bool> slots;        // frame offset -> holds the value of the call
+    std::set<int> followed;                     // labels jumped to, a loop never ends the function
+    int i = call + 1;
+    while(i < (int)code.size()) {
+        const Instruction& instr = code[i];
+        if(instr.op == Op::COMMENT || instr.op == Op::LABEL) {
+            i++;
+        }
+        else if(instr.op == Op::ADDI && instr.a.reg == SP && instr.b.reg == SP) {
+            sp += instr.c.value;
+            i++;
+        }
+        else if(instr.op == Op::SW && instr.b.reg == SP) {
+            words[sp + instr.b.value] = result[instr.a.reg];
+            i++;
+        }
+        else if(instr.op == Op::LW && instr.b.reg == SP && instr.a.reg != SP) {
+            auto found = words.find(sp + instr.b.value);
+            result[instr.a.reg] = found != words.end() && found->second;
+            i++;
+        }
+        else if(IsSlotAccess(instr)) {
+            // the frame is gone after the return, so a store to it only matters if it is loaded again
+            if(instr.op == Op::SW) slots[instr.b.value] = result[instr.a.reg];
+            else result[instr.a.reg] = slots.count(instr.b.value) && slots[instr.b.value];
+            i++;
+        }
+        else if(instr.op == Op::MOVE && instr.a.reg != SP && instr.a.reg != FP) {
+            result[instr.a.reg] = result[instr.b.reg];
+            i++;
+        }
+        else if(instr.op == Op::J) {
+            if(!followed.insert(instr.a.value).second) return false;
+            int target = -1;
+            for(int j = 0; j < (int)code.size() && target < 0; j++) {
+                if(code[j].op == Op::LABEL && code[j].a.value == instr.a.value) target = j;
+            }
+            if(target < 0) return false;
+            i = target;
+        }
+        else {
+            return false;
+        }
+    }
+    // the epilogue resets $sp from $fp, so whatever is still pushed does not matter
+    return result[V0];
+}
+
+void TailCalls::Rewrite(InstrList& list) {
+    std::vector<Instruction>& code = list.code;
+    bool loops = false;
+    // back to front, so the indices of the earlier calls stay the same
+    for(int i = code.size() - 1; i >= list.start; i--) {
+        int g = Callee(code[i]);
+        if(g < 0 || !InTailPosition(list, i)) continue;
+        const InstrList& callee = *functions[g];
+        int n = callee.params;
+        // the arguments in $a0-$a3 stay where they are, the others were pushed in order
+        int in_regs = callee.reg_args ? std::min(n, NUM_ARG_REGS) : 0;
+        if(n - in_regs > list.params - (list.reg_args ? std::min(list.params, NUM_ARG_REGS) : 0)) continue;
+        std::vector<Instruction> jump = {Instruction(Op::COMMENT, Operand(), Operand(), Operand(), "### Tail Call ###")};
+        if(&callee == &list) {
+            for(int p = 0; p < n; p++) {
+                if(p < in_regs) {
+                    jump.push_back(Instruction(Op::SW, (Register)(A0 + p), Mem(-4 * p, FP), Operand(), "write it over the parameter"));
+                    continue;
+                }
+                jump.push_back(Instruction(Op::LW, T0, Mem(4 * (n - p), SP), Operand(), "load the value of the argument"));
+                // with the arguments in registers, the pushed ones are read in place
+                Operand param = list.reg_args ? Mem(4 * (n + 2 - p), FP) : Mem(-4 * p, FP);
+                jump.push_back(Instruction(Op::SW, T0, param, Operand(), "write it over the parameter"));
+            }
+            if(n > in_regs) jump.push_back(Instruction(Op::ADDI, SP, SP, Imm(4 * (n - in_regs)), "pop the arguments"));
+            jump.push_back(Instruction(Op::J, Lbl("_tailcall_" + list.name), Operand(), Operand(), "start the function over"));
+            loops = true;
+            std::cout << "turned the tail recursion in '" << list.name << "' into a loop\n";
+        }
+        else {
+            for(int p = in_regs; p < n; p++) {
+                jump.push_back(Instruction(Op::LW, T0, Mem(4 * (n - p), SP), Operand(), "load the value of the argument"));
+                jump.push_back(Instruction(Op::SW, T0, Mem(4 * (n + 2 - p), FP), Operand(), "write it over our own arguments"));
+            }
+            jump.push_back(Instruction(Op::LA, T9, code[i].a, Operand(), "get the address of the callee"));
+            jump.push_back(Instruction(Op::J, TailReturnLabel(list.name), Operand(), Operand(), "leave the frame to the callee"));
+            list.tail_return = true;
+            std::cout << "turned the call to '" << callee.name << "' in '" << list.name << "' into a jump\n";
+        }
+        code.erase(code.begin() + i);
+        code.insert(code.begin() + i, jump.begin(), jump.end());
+    }
+    if(loops) {
+        code.insert(code.begin() + list.start,
+            Instruction(Op::LABEL, Lbl("_tailcall_" + list.name), Operand(), Operand(), "the tail calls start over here"));
+    }
+}
+
+void EliminateTailCalls(std::vector<InstrList*>& functions) {
+    TailCalls tail_calls(functions);
+    for(InstrList* list : functions) tail_calls.Rewrite(*list);
+}
@@ -0,0 +1,39 @@
+/*
+Tail.h
+Corbin Weiss
+17 October 2026
+
+Elimination of tail calls and tail recursion
+*/
+
+/*
+*** Outline of Approach ***
+A call is a tail call when nothing but returning its value is left to do after
+it. Such a call does not need a frame of its own below the frame of the caller:
+  - a call is in tail position when the instructions after the jal only pop the
+    arguments, push or move the value in $v0 around and jump to labels, until
+    the end of the function is reached with the value still in $v0. A return
+    statement does not leave the function by itself, so the scan follows the
+    jumps out of an if and gives up at anything else.
+  - a call of the function to itself becomes a loop. The arguments the call
+    pushed or put in $a0-$a3 are copied into the parameters and the jal becomes
+    a jump to a label right after the parameters are copied from the caller, so
+    deep recursion runs in constant stack space.
+  - a call to another function that pushes no more arguments than the caller
+    got reuses the frame of the caller. The pushed arguments are copied over
+    the arguments of the caller, the ones in $a0-$a3 stay where they are, the
+    address of the callee is loaded into $t9 and the call becomes a jump to the
+    epilogue. Once the registers are allocated and the epilogue is known,
+    BuildFrame puts a copy of it in place of every such jump, ending in a jump
+    to the callee instead of jr $ra. The callee then returns straight to the
+    caller of the caller, which pops the arguments it pushed.
+Every call that is turned into a jump is reported.
+*/
+#pragma once
+#include "Instruction.h"
+
+// the label the tail calls to other functions jump to, replaced by copies of the epilogue
+Operand TailReturnLabel(const std::string& name);
+
+// turn the tail calls between the functions into jumps
+void EliminateTailCalls(std::vector<InstrList*>& functions);
@@ -0,0 +1,232 @@
+const char* PRINT_HEADER = R"(
+	.align 2
+	optr:	.word obuf	# next free byte of the output buffer
+	obuf:	.space 256	# output that has not been printed yet
+	oend:	.space 16	# room for the value that fills the buffer and the end of the string
+)";
+
+const char* DIGITS_HEADER = R"(
+	odigits: .space 12	# the digits of a number, written backwards
+)";
+
+const char* PUTC_BODY = R"(
+
+####################################################
+# __putc, __puti, __puts
+# Input:	$a0 holds the character, the number or
+#		the address of the string to append
+# Description:
+#	  The output of print statements is appended
+#	to a buffer in .data instead of being printed
+#	one value at a time. The buffer is printed
+#	with a single syscall when a newline is
+#	appended, when it is full and at __exit.
+#	  A value is appended after the buffer has
+#	been checked to have room left, so a number
+#	or a string of up to 15 characters always
+#	fits. Only $t0-$t4, $t9 and $v0 are used.
+####################################################
+
+__putc:
+	lw $t0 optr
+	sb $a0 ($t0)	# append the character
+	addiu $t0 $t0 1
+	sw $t0 optr
+	li $t1 10
+	beq $a0 $t1 __flush	# a newline prints the line
+	la $t1 oend
+	bgeu $t0 $t1 __flush	# the buffer is full
+	jr $ra
+)";
+
+const char* PUTI_BODY = R"(
+
+__puti:
+	lw $t0 optr
+	move $t1 $a0
+	bltz $t1 pineg
+	subu $t1 $zero $t1	# work on -n, which also holds -2^31
+	b pidigits
+pineg:
+	li $t2 45
+	sb $t2 ($t0)	# the minus sign
+	addiu $t0 $t0 1
+pidigits:
+	la $t4 odigits
+	addiu $t3 $t4 12	# the digits end here
+	li $t2 10
+	li $t9 48	# '0'
+pidigit:
+	rem $v0 $t1 $t2	# the last digit, as a negative number
+	div $t1 $t1 $t2
+	subu $v0 $t9 $v0	# '0' + digit
+	addiu $t3 $t3 -1
+	sb $v0 ($t3)
+	bnez $t1 pidigit
+	addiu $t4 $t4 12
+picopy:
+	lb $v0 ($t3)	# copy the digits into the buffer
+	sb $v0 ($t0)
+	addiu $t0 $t0 1
+	addiu $t3 $t3 1
+	bne $t3 $t4 picopy
+	sw $t0 optr
+	la $t1 oend
+	bgeu $t0 $t1 __flush
+	jr $ra
+)";
+
+const char* PUTS_BODY = R"(
+
+__puts:
+	lw $t0 optr
+	move $t3 $a0
+pscopy:
+	lb $v0 ($t3)
+	beqz $v0 psdone
+	sb $v0 ($t0)
+	addiu $t0 $t0 1
+	addiu $t3 $t3 1
+	b pscopy
+psdone:
+	sw $t0 optr
+	la $t1 oend
+	bgeu $t0 $t1 __flush
+	jr $ra
+)";
+
+const char* PRINT_ARRAY_I32_BODY = R"(
+
+####################################################
+# __print_array_i32, __print_array_bool, __print_str
+# Input:	$a0 holds the address of the array, whose
+#		first word is the number of elements
+# Description:
+#	  Append the elements of an array, each
+#	followed by a space, or the characters of a
+#	string. The loops are kept here once instead
+#	of at every print statement. They walk a
+#	pointer in $t5 up to the last element in $t6
+#	and keep $ra in $t8, which the routines
+#	above do not use.
+####################################################
+
+__print_array_i32:
+	move $t8 $ra
+	lw $t6 ($a0)	# number of elements
+	sll $t6 $t6 2
+	addu $t6 $t6 $a0	# address of the last element
+	addiu $t5 $a0 4	# address of the first element
+pailoop:
+	bgt $t5 $t6 paidone
+	lw $a0 ($t5)
+	jal __puti
+	li $a0 32
+	jal __putc	# the space after it
+	addiu $t5 $t5 4
+	b pailoop
+paidone:
+	jr $t8
+)";
+
+const char* PRINT_ARRAY_BOOL_BODY = R"(
+
+__print_array_bool:
+	move $t8 $ra
+	lw $t6 ($a0)
+	sll $t6 $t6 2
+	addu $t6 $t6 $a0
+	addiu $t5 $a0 4
+pabloop:
+	bgt $t5 $t6 pabdone
+	lw $t7 ($t5)
+	la $a0 false
+	beqz $t7 pabfalse
+	la $a0 true
+pabfalse:
+	jal __puts
+	li $a0 32
+	jal __putc
+	addiu $t5 $t5 4
+	b pabloop
+pabdone:
+	jr $t8
+)";
+
+const char* PRINT_STR_BODY = R"(
+
+__print_str:
+	move $t8 $ra
+	lw $t6 ($a0)
+	sll $t6 $t6 2
+	addu $t6 $t6 $a0
+	addiu $t5 $a0 4
+psloop:
+	bgt $t5 $t6 psend
+	lw $a0 ($t5)
+	jal __putc	# the characters have no spaces between them
+	addiu $t5 $t5 4
+	b psloop
+psend:
+	jr $t8
+)";
+
+const char* FLUSH_BODY = R"(
+
+####################################################
+# __flush()
+# Description:
+#	  Prints what the buffer holds with the print
+#	string syscall and empties it. $a0 is kept.
+####################################################
+
+__flush:
+	lw $t0 optr
+	la $t1 obuf
+	beq $t0 $t1 fldone	# nothing to print
+	sb $zero ($t0)	# end the string
+	sw $t1 optr
+	move $t2 $a0
+	move $a0 $t1
+	li $v0 4	# syscall 4 (print_str)
+	syscall
+	move $a0 $t2
+fldone:
+	jr $ra
+)";
+
+const char* TRAP_BODY = R"(
+
+####################################################
+# __trap
+# Description:
+#	  The exception handler of MARS. A trap such as
+#	an arithmetic overflow would stop the program
+#	with the output still in the buffer lost, so
+#	it is printed first, followed by the cause of
+#	the exception, and the program exits.
+####################################################
+
+	.ktext 0x80000180
+__trap:
+	jal __flush	# the output so far comes before the error
+	mfc0 $k0 $13	# the cause of the exception
+	srl $k0 $k0 2
+	andi $k0 $k0 31	# its code
+	li $k1 12	# arithmetic overflow
+	bne $k0 $k1 trother
+	la $a0 overflow
+	li $v0 4
+	syscall
+	li $v0 10
+	syscall
+trother:
+	la $a0 exception
+	li $v0 4
+	syscall
+	move $a0 $k0	# the code of any other exception
+	li $v0 1
+	syscall
+	li $v0 10
+	syscall
+)";
@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <limits>
+#include <cstring>
 #include "AST.h"
 #include "ErrorData.h"
 
@@ -17,7 +18,10 @@ int yylex();
 int yyparse();
 void yyerror (char const *str);
 
-FILE *fdout; // global file descriptor for output MIPS code file
+Emitter *emitter; // global buffered writer for the output MIPS code file
+bool reg_args = false;  // --regargs passes the first four arguments in $a0-$a3
+bool debug_heap = false;    // --debugheap checks every free for memory that is not malloced or already free
+bool regions = false;   // --regions takes the arrays that calls do not keep from a region of each activation
 extern FILE *yyin;
 extern char* yytext;
 extern char *lineptr;
@@ -52,7 +56,7 @@ input           : program {
                 ;
 
 program         : func_def_list main_def {
-                    $$ = new ProgramNode($1, $2, fdout);
+                    $$ = new ProgramNode($1, $2, emitter, reg_args, debug_heap, regions);
                 }
                 ;
 
@@ -355,21 +359,43 @@ string          : STRING {
 
 
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
+    bool compact = false;   // --compact drops comments from a.s
+    char* filename = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--compact") == 0) {
+            compact = true;
+        }
+        else if (strcmp(argv[i], "--regargs") == 0) {
+            reg_args = true;
+        }
+        else if (strcmp(argv[i], "--debugheap") == 0) {
+            debug_heap = true;
+        }
+        else if (strcmp(argv[i], "--regions") == 0) {
+            regions = true;
+        }
+        else {
+            filename = argv[i];
+        }
+    }
+    if (!filename) {
+        std::cerr << "Usage: " << argv[0] << " [--compact] [--regargs] [--debugheap] [--regions] <filename>" << std::endl;
         return 1;
     }
 
-    yyin = fopen(argv[1], "r");
+    yyin = fopen(filename, "r");
     if (!yyin) {
         perror("Error opening file");
         return 1;
     }
 
-    fdout = fopen("a.s", "w");
+    FILE* fdout = fopen("a.s", "w");
+    emitter = new Emitter(fdout, compact);
 
     yyparse();  // Call the Bison parser
 
+    delete emitter;     // write out anything still buffered
+    fclose(fdout);
     fclose(yyin);
     return 0;
 }